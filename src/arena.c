@@ -0,0 +1,83 @@
+/* Copyright (c) 2003 ACM/SIGDA
+   Prepared by Geert Janssen, geert@us.ibm.com
+*/
+
+/* ------------------------------------------------------------------------ */
+/* INCLUDES                                                                 */
+/* ------------------------------------------------------------------------ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "arena.h"
+
+/* ------------------------------------------------------------------------ */
+/* LOCAL DEFINES                                                            */
+/* ------------------------------------------------------------------------ */
+
+/* Initial block size in bytes: */
+#define ARENA_INIT_SIZE	(64 * 1024)
+
+/* Alignment of all allocations: */
+#define ARENA_ALIGN	16
+#define ALIGN_UP(n)	(((n) + ARENA_ALIGN - 1) & ~(size_t) (ARENA_ALIGN - 1))
+
+/* ------------------------------------------------------------------------ */
+/* FUNCTION DEFINITIONS                                                     */
+/* ------------------------------------------------------------------------ */
+
+void
+arena_init(Arena *a)
+{
+  a->base = NULL;
+  a->size = 0;
+  a->top  = 0;
+  a->peak = 0;
+  a->grows = 0;
+}
+
+size_t
+arena_alloc(Arena *a, size_t bytes)
+{
+  size_t off = a->top;
+  size_t top = off + ALIGN_UP(bytes);
+
+  if (top > a->size) {
+    size_t size = a->size ? a->size : ARENA_INIT_SIZE;
+    char *base;
+
+    while (size < top)
+      size *= 2;
+    base = realloc(a->base, size);
+    if (!base) {
+      printf("[arena_alloc]: memory allocation failed.\n");
+      exit(1);
+    }
+    a->base = base;
+    a->size = size;
+    a->grows++;
+  }
+  a->top = top;
+  if (top > a->peak)
+    a->peak = top;
+  return off;
+}
+
+void
+arena_release(Arena *a, size_t off)
+{
+  a->top = ALIGN_UP(off);
+}
+
+void
+arena_reset(Arena *a)
+{
+  a->top  = 0;
+  a->peak = 0;
+}
+
+void
+arena_free(Arena *a)
+{
+  free(a->base);
+  arena_init(a);
+}
@@ -0,0 +1,73 @@
+/* Copyright (c) 2003 ACM/SIGDA
+   Prepared by Geert Janssen, geert@us.ibm.com
+*/
+
+#ifndef ARENA_H
+#define ARENA_H
+
+/* ------------------------------------------------------------------------ */
+/* INCLUDES								    */
+/* ------------------------------------------------------------------------ */
+
+#include <stddef.h>
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+/* ------------------------------------------------------------------------ */
+/* DEFINES								    */
+/* ------------------------------------------------------------------------ */
+
+/* Arena field access macros: */
+#define ARENA_AT(a,off)		((void *) ((a)->base + (off)))
+#define ARENA_TOP(a)		((a)->top)
+#define ARENA_PEAK(a)		((a)->peak)
+#define ARENA_GROWS(a)		((a)->grows)
+
+/* ------------------------------------------------------------------------ */
+/* TYPE DEFINITIONS							    */
+/* ------------------------------------------------------------------------ */
+
+/* A bump allocator with stack discipline:
+   memory is handed out from a single contiguous block and given back by
+   releasing everything above a certain offset. Allocations are identified
+   by their byte offset from the base, because the base moves whenever the
+   block has to grow; pointers obtained through ARENA_AT are only valid
+   until the next allocation.
+*/
+typedef struct Arena_S Arena;
+struct Arena_S {
+  char *base;			/* start of the block */
+  size_t size;			/* allocated size of the block in bytes */
+  size_t top;			/* offset of first free byte */
+  size_t peak;			/* highest top since last reset */
+  unsigned long grows;		/* number of times the block was allocated */
+};
+
+/* ------------------------------------------------------------------------ */
+/* FUNCTION PROTOTYPES							    */
+/* ------------------------------------------------------------------------ */
+
+/* Initializes an empty arena. */
+void arena_init(Arena *a);
+
+/* Returns the offset of a fresh block of `bytes' bytes on top of the arena.
+   The block is suitably aligned for any basic type.
+*/
+size_t arena_alloc(Arena *a, size_t bytes);
+
+/* Releases everything allocated at or above offset `off'. */
+void arena_release(Arena *a, size_t off);
+
+/* Releases all allocations and clears the peak count; keeps the memory. */
+void arena_reset(Arena *a);
+
+/* Returns the arena memory to the system. */
+void arena_free(Arena *a);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ARENA_H */
@@ -0,0 +1,167 @@
+/* Copyright (c) 2003 ACM/SIGDA
+   Prepared by Geert Janssen, geert@us.ibm.com
+*/
+
+/* ------------------------------------------------------------------------ */
+/* INCLUDES                                                                 */
+/* ------------------------------------------------------------------------ */
+
+#include <stdint.h>
+#include "bintree.h"
+
+/* ------------------------------------------------------------------------ */
+/* LOCAL DEFINES                                                            */
+/* ------------------------------------------------------------------------ */
+
+#define BINTREE_ORDER	0x01020304
+/* Version 1 files had binary trees only, with two subtree indices per
+   node instead of a count:
+*/
+#define BINTREE_VERSION	2
+/* Bytes per node, not counting the leaf bits: */
+#define BINTREE_NODE	32
+
+/* ------------------------------------------------------------------------ */
+/* LOCAL TYPE DEFINITIONS                                                   */
+/* ------------------------------------------------------------------------ */
+
+/* File header; 32 bytes so that the arrays following it are aligned. */
+typedef struct Header_S {
+  char magic[BINTREE_MAGIC_LEN];
+  uint32_t order;		/* BINTREE_ORDER in writer's byte order */
+  uint32_t version;		/* BINTREE_VERSION */
+  uint32_t nodes;		/* number of nodes */
+  uint32_t unused;
+  uint64_t strtab;		/* string table size in bytes */
+} Header;
+
+/* ------------------------------------------------------------------------ */
+/* FUNCTION DEFINITIONS                                                     */
+/* ------------------------------------------------------------------------ */
+
+static void *
+xmalloc(size_t size)
+{
+  void *p = malloc(size ? size : 1);
+
+  if (!p) {
+    printf("[bintree]: memory allocation failed.\n");
+    exit(1);
+  }
+  return p;
+}
+
+int
+bintree_is(const char *buf, size_t size)
+{
+  return size >= BINTREE_MAGIC_LEN
+    && !memcmp(buf, BINTREE_MAGIC, BINTREE_MAGIC_LEN);
+}
+
+int
+bintree_write(FILE *fp, FTree f)
+{
+  Names *nt = f->names;
+  const uint32_t *id = f->id;
+  uint32_t *ids = NULL;
+  Header h;
+  uint32_t i, n = F_SIZE(f);
+  size_t bits = (n + 7) / 8;
+  int ok;
+
+  /* Deduplicated names already are a compact string table, with handles
+     as offsets; else the distinct names are collected in one:
+  */
+  if (!nt->dedup) {
+    nt = names_mk(1);
+    id = ids = xmalloc(n * sizeof(*ids));
+    for (i = 0; i < n; i++)
+      ids[i] = names_intern(nt, F_NAME(f, i));
+  }
+
+  memset(&h, 0, sizeof(h));
+  memcpy(h.magic, BINTREE_MAGIC, BINTREE_MAGIC_LEN);
+  h.order   = BINTREE_ORDER;
+  h.version = BINTREE_VERSION;
+  h.nodes   = n;
+  h.strtab  = nt->size;
+
+  /* The unused bits of the last leaf byte are always clear. */
+  ok = fwrite(&h, sizeof(h), 1, fp) == 1
+    && fwrite(f->wire, sizeof(double), n, fp) == n
+    && fwrite(f->time, sizeof(double), n, fp) == n
+    && fwrite(f->load, sizeof(double), n, fp) == n
+    && fwrite(f->nsub, sizeof(uint32_t), n, fp) == n
+    && fwrite(id, sizeof(uint32_t), n, fp) == n
+    && fwrite(f->leaf, 1, bits, fp) == bits
+    && fwrite(nt->text, 1, nt->size, fp) == nt->size;
+  if (ids) {
+    free(ids);
+    names_free(nt);
+  }
+  return ok ? 0 : -1;
+}
+
+/* Give format error message and abort program. */
+static void
+malformed(const char *mes)
+{
+  fprintf(stderr, "Binary tree format error: %s.\n", mes);
+  exit(1);
+}
+
+FTree
+bintree_decode(const char *buf, size_t size)
+{
+  const Header *h = (const Header *) buf;
+  const char *strtab;
+  uint32_t top = 0;
+  FTree f;
+  uint32_t i, n;
+
+  if (size < sizeof(*h) || !bintree_is(buf, size))
+    malformed("bad magic");
+  if (h->order != BINTREE_ORDER)
+    malformed("wrong byte order");
+  if (h->version != BINTREE_VERSION)
+    malformed("unsupported version");
+  n = h->nodes;
+  if (!n || (size - sizeof(*h)) / BINTREE_NODE < n
+      || size - sizeof(*h) - BINTREE_NODE * (size_t) n - (n + 7) / 8
+	 != h->strtab)
+    malformed("bad size");
+
+  /* The node arrays are used in place: */
+  f = xmalloc(sizeof(*f));
+  f->n    = n;
+  f->cap  = 0;
+  f->wire = (double *) (h + 1);
+  f->time = f->wire + n;
+  f->load = f->time + n;
+  f->nsub = (uint32_t *) (f->load + n);
+  f->id   = f->nsub + n;
+  f->leaf = (unsigned char *) (f->id + n);
+  strtab  = (const char *) (f->leaf + (n + 7) / 8);
+  if (!h->strtab || strtab[h->strtab - 1])
+    malformed("bad string table");
+  /* The name offsets are the handles of the string table: */
+  f->names  = names_wrap(strtab, h->strtab);
+  f->shared = 0;
+
+  /* Check the post-order: each internal node consumes the subtrees most
+     recently completed, of which there must be enough. Only their number
+     matters, so no stack is needed.
+  */
+  for (i = 0; i < n; i++) {
+    if (F_ID(f, i) >= h->strtab)
+      malformed("bad name");
+    if (F_LEAF(f, i) ? F_NSUB(f, i) != 0
+	: !F_NSUB(f, i) || F_NSUB(f, i) > top)
+      malformed("nodes not in post-order");
+    top -= F_NSUB(f, i);
+    top++;
+  }
+  if (top != 1)
+    malformed("not a single tree");
+  return f;
+}
@@ -0,0 +1,57 @@
+/* Copyright (c) 2003 ACM/SIGDA
+   Prepared by Geert Janssen, geert@us.ibm.com
+*/
+
+#ifndef BINTREE_H
+#define BINTREE_H
+
+#include "tree.h"
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+/* Compact binary format for fanout trees.
+   A file starts with a fixed header, followed by the node arrays of a flat
+   tree (see `tree.h', so in post-order) and a string table:
+
+        Header        : magic "BUFTREE\0", byte-order mark 0x01020304,
+                        version, number of nodes n, size of string table.
+        double  wire[n]   wire length to parent
+        double  time[n]   sink required arrival time (0 for internal nodes)
+        double  load[n]   sink capacitive load (0 for internal nodes)
+        uint32  nsub[n]   number of subtrees (0 for sinks)
+        uint32  name[n]   offset of node name in the string table
+        uint8   leaf[(n+7)/8]   bit i set iff node i is a sink
+        char    strtab[]  '\0'-terminated names, each distinct name once
+
+   The string table is the table of names of the flat tree (see `names.h'),
+   and the name offsets are its handles.
+
+   All values are in the byte order of the machine that wrote the file.
+*/
+
+#define BINTREE_MAGIC		"BUFTREE"
+#define BINTREE_MAGIC_LEN	8
+
+/* Returns 1 if the size bytes at buf start like a binary tree file. */
+int bintree_is(const char *buf, size_t size);
+
+/* Writes flat tree f in binary format to fp. Returns 0 on success, -1 on
+   a write error.
+*/
+int bintree_write(FILE *fp, FTree f);
+
+/* Returns the flat tree stored in binary format in the size bytes at buf.
+   The node arrays and string table are used in place, so buf must be
+   8-byte aligned and stay available (and unmodified) as long as the tree
+   is in use; nothing is allocated per node. Aborts (with exit(1)) when the data
+   is malformed.
+*/
+FTree bintree_decode(const char *buf, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BINTREE_H */
@@ -6,455 +6,907 @@
 /* INCLUDES								    */
 /* ------------------------------------------------------------------------ */
 
+#include <unistd.h>
+#include <time.h>
 #include <math.h>
+#include <sys/resource.h>
 #include "parser.h"
+#include "bintree.h"
+#include "engine.h"
 
 /* ------------------------------------------------------------------------ */
 /* LOCAL DEFINES                                                            */
 /* ------------------------------------------------------------------------ */
 
-/* Define this to resort to a simple-minded solution approach. */
-#define _CHICKEN
+/* Number of batch jobs in flight per worker thread: */
+#define JOBS_PER_WORKER	4
 
-/* Accuracy in comparing two floating point numbers for equality. */
-#define EPS		1e-5
-#define EQUAL(a,b)	(fabs((a) - (b)) < EPS)
-
-#define min(a,b)	((a) < (b) ? (a) : (b))
-#define max(a,b)	((a) > (b) ? (a) : (b))
-
-#define OFLAG(x)	((x)->flag)
-#define OPAIR(x)	((x)->p)
-#define OTIME(x)	PTIME(OPAIR(x))
-#define OLOAD(x)	PLOAD(OPAIR(x))
-#define ONEXT(x)	((x)->next)
-
-#define PTIME(x)	((x).T)
-#define PLOAD(x)	((x).L)
-
-#define VISIT_MASK	0x1
-#define VISIT(x)	(FLAG(x) |  VISIT_FLAG)
-#define UNVISIT(x)	(FLAG(x) & ~VISIT_FLAG)
-#define VISITED(x)	(!!(FLAG(x) & VISIT_FLAG))
-
-#define OPTS_GET(x)	((Options) T_DATA(x))
-#define OPTS_SET(x,o)	(T_DATA(x) = (x))
+/* Number of technology parameters that can be swept, see sweep_names: */
+#define SWEEP_PARAMS	5
 
 /* ------------------------------------------------------------------------ */
 /* LOCAL TYPE DEFINITIONS                                                   */
 /* ------------------------------------------------------------------------ */
 
-typedef unsigned int	Bool;
-typedef unsigned int	Nat;
-typedef double		Time;
-typedef double		Capacitance;
-typedef double		Resistance;
-typedef double		Length;
-
-/* An option pair. */
-typedef struct Pair_S {
-  Time T;			/* required arrival time */
-  Capacitance L;		/* overall capacitive load */
-} Pair;
-
-/* A list of option pairs. */
-typedef struct Options_S *Options;
-struct Options_S {
-  /*Nat flag;*/			/* as yet unused */
-  Pair p;			/* the element pair */
-  Options next;			/* rest of list or NULL */
-};
+/* Shared state of a batch run. */
+typedef struct Batch_S {
+  Pool *pool;
+  Engine *engines;		/* one per worker */
+  int stats;			/* report arena usage */
+  int inplace;			/* take names from the input text */
+} Batch;
+
+/* A tree being solved while it is read. */
+typedef struct Stream_S {
+  Engine *e;
+  unsigned long nodes, sinks;	/* read so far */
+} Stream;
+
+/* One input file or tree of a batch run, solved as a task. */
+typedef struct Job_S {
+  Task task;			/* must be first */
+  Batch *batch;
+  const char *fname;		/* file to solve all trees of, or NULL */
+  FTree f;			/* else the tree to solve */
+  int failed;			/* fname could not be opened */
+  char *out, *err;		/* text for stdout and stderr */
+  size_t outlen, errlen;
+} Job;
+
+/* The values of one technology parameter in a sweep: steps of them,
+   evenly spaced from from to to.
+*/
+typedef struct Range_S {
+  double from, to;
+  unsigned long steps;		/* 0 while not given */
+} Range;
+
+/* Shared state of a parameter sweep. */
+typedef struct Sweep_S {
+  Pool *pool;
+  Engine *engines;		/* one per worker */
+  FTree f;			/* the tree, only read */
+} Sweep;
+
+/* One point of the grid of a sweep, solved as a task. */
+typedef struct Point_S {
+  Task task;			/* must be first */
+  Sweep *sweep;
+  double values[SWEEP_PARAMS];	/* of the parameters */
+  Result r;
+} Point;
+
+/* A tree node with its name, to look it up by name in edit mode. */
+typedef struct Named_S {
+  const char *name;
+  Tree k;
+  int repeated;			/* other nodes have the same name */
+} Named;
 
 /* ------------------------------------------------------------------------ */
 /* VARIABLES		                                                    */
 /* ------------------------------------------------------------------------ */
-/* ADDED FOR ECE756 HWK */
-/* Boolean variable added to add a bunch of debug messages for merge/filter */
-static Bool my_debug = 0;
-/* END ADDED FOR ECE756 HWK */
-
-static Bool debug = 0;
 
-/* Per unit wire length resistance and capacitance values: */
-static Resistance	R_unit =  0.1; /* [Ohm/m] */
-static Capacitance	C_unit =  0.2; /* [F/m] */
+/* The technology parameters that can be swept, as named on the command
+   line and in the results table; see tech_param.
+*/
+static const char *const sweep_names[SWEEP_PARAMS] = {
+  "R_unit", "C_unit", "R_buf", "C_buf", "D_buf"
+};
 
-/* Buffer parameters: */
-static Resistance	R_buf  = 10.0; /* Ohm */
-static Capacitance	C_buf  =  4.0; /* femto Farad */
-static Time		D_buf  =  2.0; /* nano sec */
+/* Number of heap allocations made so far, by all threads: */
+static unsigned long allocs;
 
 /* ------------------------------------------------------------------------ */
 /* FUNCTION DEFINITIONS                                                     */
 /* ------------------------------------------------------------------------ */
 
-/* Returns the pair (T,L). */
-static Pair
-pair_mk(Time T, Capacitance L)
-{
-  Pair p;
+/* The allocator, wrapped at link time (see the Makefile) to count the
+   allocations of all modules for -t:
+*/
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t n, size_t size);
+void *__real_realloc(void *p, size_t size);
 
-  PTIME(p) = T;
-  PLOAD(p) = L;
-  return p;
+void *
+__wrap_malloc(size_t size)
+{
+  __atomic_fetch_add(&allocs, 1, __ATOMIC_RELAXED);
+  return __real_malloc(size);
 }
 
-static void
-pair_show(FILE *fp, Pair p)
+void *
+__wrap_calloc(size_t n, size_t size)
 {
-  fprintf(fp, "(%.2f, %.2f)", PTIME(p), PLOAD(p));
+  __atomic_fetch_add(&allocs, 1, __ATOMIC_RELAXED);
+  return __real_calloc(n, size);
 }
 
-static Options
-option_mk(Pair p)
+void *
+__wrap_realloc(void *p, size_t size)
 {
-  Options o = malloc(sizeof(*o));
-
-  OPAIR(o) = p;
-  ONEXT(o) = NULL;
-  return o;
+  __atomic_fetch_add(&allocs, 1, __ATOMIC_RELAXED);
+  return __real_realloc(p, size);
 }
 
+/* Prints a buffer location to FILE arg. */
 static void
-option_free(Options o)
+location_show(const char *id, const Buffer *b, void *arg)
 {
-  if (o)
-    free(o);
+  if (b)
+    fprintf(arg, "buffer %s at %s\n", b->id, id);
+  else
+    fprintf(arg, "buffer at %s\n", id);
 }
 
-#if 0
-static Options
-options_copy(Options o)
+/* Prints the results r for one tree to out, followed by the buffer
+   locations when engine e traces, and if stats is set the memory usage of
+   engine e to err.
+*/
+static void
+report(FILE *out, FILE *err, Result r, Engine *e, int stats)
 {
-  Options Z, *tail = &Z;
-
-  while (o) {
-    *tail = option_mk(OPAIR(o));
-    tail = &ONEXT(*tail);
-    o = ONEXT(o);
+  pair_show(out, r.nb);
+  fprintf(out, "\n");
+  pair_show(out, r.best);
+  fprintf(out, "\n");
+  if (e->tech.trace)
+    engine_buffers(e, location_show, out);
+  if (stats) {
+    fprintf(err, "arena peak: %lu bytes\n", (unsigned long) ENGINE_PEAK(e));
+    if (e->tech.trace)
+      fprintf(err, "trace records: %lu bytes\n",
+	      (unsigned long) ARENA_TOP(&e->trail.traces));
   }
-  return Z;
 }
 
-static Nat
-options_len(Options o)
+/* Returns the time in seconds since some fixed point in the past. */
+static double
+now(void)
 {
-  Nat len;
+  struct timespec ts;
 
-  for (len = 0; o; o = ONEXT(o), len++)
-    ;
-  return len;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
 }
-#endif
 
-static Options
-options_last(Options o)
+/* Returns the number of sinks of flat tree f. */
+static unsigned long
+sinks_count(FTree f)
 {
-  while (o) {
-    Options next = ONEXT(o);
+  unsigned long sinks = 0;
+  uint32_t k;
 
-    if (!next)
-      return o;
-    o = next;
-  }
-  return NULL;
+  for (k = 0; k < F_SIZE(f); k++)
+    sinks += F_LEAF(f, k);
+  return sinks;
 }
 
+/* Prints measurements for solving a tree of the given numbers of nodes
+   and sinks with engine e to fp, as one line of name=value fields, for
+   benchmark scripts. The allocations are those of the whole run so far,
+   reading the input included.
+*/
 static void
-options_free(Options o)
+measure_show(FILE *fp, unsigned long nodes, unsigned long sinks, Engine *e,
+	     double parse, double solve)
 {
-  while (o) {
-    Options next = ONEXT(o);
-    option_free(o);
-    o = next;
-  }
+  Stats st = ENGINE_STATS(e);
+  struct rusage ru;
+
+  getrusage(RUSAGE_SELF, &ru);
+  fprintf(fp, "nodes=%lu sinks=%lu parse_s=%.6f solve_s=%.6f"
+	  " options_per_node=%.2f max_options=%lu"
+	  " memo_hits=%lu memo_misses=%lu specialized=%d"
+	  " arena_peak=%lu arena_grows=%lu allocs=%lu peak_rss_kb=%ld\n",
+	  nodes, sinks, parse, solve,
+	  st.nodes ? (double) st.options / st.nodes : 0.0, st.max_options,
+	  st.memo_hits, st.memo_misses, st.specialized,
+	  (unsigned long) ENGINE_PEAK(e), ENGINE_GROWS(e),
+	  __atomic_load_n(&allocs, __ATOMIC_RELAXED), ru.ru_maxrss);
 }
 
 static void
-options_show(FILE *fp, Options o, const char *msg)
+stream_leaf(void *arg, const char *id, double wire, double time, double load)
 {
-  fprintf(fp, "%s", msg);
-  while (o) {
-    Options next;
-
-    pair_show(fp, OPAIR(o));
-    next = ONEXT(o);
-    if (next)
-      fprintf(fp, ", ");
-    o = next;
-  }
-  fprintf(fp, "\n");
+  Stream *s = arg;
+
+  engine_stream_leaf(s->e, id, wire, time, load);
+  s->nodes++;
+  s->sinks++;
 }
 
 static void
-node_options_show(FILE *fp, Options o, Tree k)
+stream_inode(void *arg, const char *id, double wire, uint32_t nsub)
 {
-  char buf[64];
+  Stream *s = arg;
 
-  sprintf(buf, "%s: ", T_NAME(k));
-  options_show(stdout, o, buf);
+  engine_stream_node(s->e, id, wire, nsub);
+  s->nodes++;
 }
 
-/* ------------------------------------------------------------------------ */
-
-/* Returns (singleton) options list for sink node k. */
-static Options
-options_sink(Tree k)
+/* Solves the first tree in file fname, or in stdin if it is NULL, with
+   engine e while it is read, so that neither the text nor the tree is
+   ever completely in memory. Returns 1 on failure.
+*/
+static int
+stream(Engine *e, const char *fname, int stats, int measure)
 {
-  Options Z;
-
-  Z = option_mk(pair_mk(T_TIME(k), T_LOAD(k)));
-  if (debug)
-    options_show(stdout, Z, "Sink:\n");
-  return Z;
+  Input *in = input_stream(fname);
+  Stream s;
+  Builder b;
+  double start;
+  Result r;
+
+  if (!in) {
+    fprintf(stderr, "Cannot open file `%s' for reading.\n", fname);
+    return 1;
+  }
+  s.e = e;
+  s.nodes = s.sinks = 0;
+  b.leaf = stream_leaf;
+  b.inode = stream_inode;
+  b.arg = &s;
+  start = now();
+  engine_stream_start(e);
+  if (!parse_build(in, &b)) {
+    fprintf(stderr, "Tree expected.\n");
+    engine_stream_abort(e);
+    input_close(in);
+    return 1;
+  }
+  r = engine_stream_end(e);
+  input_close(in);
+  report(stdout, stderr, r, e, stats);
+  /* Parsing and solving are interleaved, and timed together: */
+  if (measure)
+    measure_show(stderr, s.nodes, s.sinks, e, 0.0, now() - start);
+  return 0;
 }
 
-
-/************************************************/
-/* (FILLED BY YOU) */
-
-/* Filter out inferior pairs from the Options list.*/
-static Options options_filter(Options Z, Nat len){
-
-  return Z; //replace this line
+/* Solves tree f exactly with technology tech, and prints to fp how much
+   less slack the approximate solution r has at the root.
+*/
+static void
+loss_show(FILE *fp, FTree f, const Tech *tech, Result r)
+{
+  Tech exact = *tech;
+  Engine e;
+  Result x;
+
+  exact.tol = 0.0;
+  exact.cap = 0;
+  engine_init(&e, &exact);
+  x = engine_solve(&e, f);
+  engine_done(&e);
+  fprintf(fp, "slack loss versus exact: %.2f\n", PTIME(x.best) - PTIME(r.best));
 }
 
-/************************************************/
-
-/* Add wire segment of length l.
-   Update rules:
-
-   T = T - R * C / 2.0 - R * L
-   L = L + C
-
-   Returns possibly modified options list Z.
+/* Solves the tree or all trees in the file of job t, with the engine of
+   the worker that runs it. Output is collected in memory, so that it can
+   be printed in input order.
 */
-static Options
-options_add_wire(Options Z, Length l)
+static void
+job_run(Task *t)
 {
-  Resistance  R = R_unit * l;
-  Capacitance C = C_unit * l;
-  Options o;
-  Nat len;
-
-  for (o = Z, len = 0; o; o = ONEXT(o), len++) {
-    OTIME(o) -= R * (C / 2.0 + OLOAD(o));
-    OLOAD(o) += C;
+  Job *j = (Job *) t;
+  Batch *b = j->batch;
+  Engine *e = &b->engines[pool_worker(b->pool)];
+  FILE *out = open_memstream(&j->out, &j->outlen);
+  FILE *err = open_memstream(&j->err, &j->errlen);
+
+  if (!out || !err) {
+    printf("[job_run]: memory allocation failed.\n");
+    exit(1);
   }
-  if (debug)
-    options_show(stdout, Z, "Added wire:\n");
-
-  return options_filter(Z, len);
+  if (j->fname) {
+    Input *in = input_open(j->fname);
+    FTree f;
+
+    if (in) {
+      in->inplace = b->inplace;
+      while ((f = parse_next(in))) {
+	report(out, err, engine_solve(e, f), e, b->stats);
+	ftree_free(f);
+      }
+      input_close(in);
+    }
+    else {
+      fprintf(err, "Cannot open file `%s' for reading.\n", j->fname);
+      j->failed = 1;
+    }
+  }
+  else
+    report(out, err, engine_solve(e, j->f), e, b->stats);
+  fclose(out);
+  fclose(err);
 }
 
-/* Add buffer option.
-   Update rules:
-
-   T = T - Dbuf - Rbuf * L
-   L = Cbuf
+/* Waits for job j, prints its output and frees it. Returns 1 when it
+   failed.
+*/
+static int
+job_finish(Job *j)
+{
+  int failed;
+
+  pool_wait(j->batch->pool, &j->task);
+  fwrite(j->out, 1, j->outlen, stdout);
+  fwrite(j->err, 1, j->errlen, stderr);
+  failed = j->failed;
+  if (j->f)
+    ftree_free(j->f);
+  free(j->out);
+  free(j->err);
+  free(j);
+  return failed;
+}
 
-   Returns possibly modified options list Z.
+/* Solves all trees in the given files, or in stdin when there are none,
+   with `threads' nets in progress at the same time. Results appear in
+   input order. Returns the number of files that could not be read.
 */
-static Options
-options_add_buffer(Options Z)
+static int
+batch(char *files[], int nfiles, const Tech *tech, int threads, int stats,
+      int inplace)
 {
-  Options *tail, o;
-  Nat len;
-  Time Tmax;
-
-#ifdef CHICKEN
-  /* For each option, calculate new option when buffer is added, and
-     insert that new option right after the original one.
-     Of course this disrupts the order and also might introduce redundant
-     options, therefore must explicitly sort/filter the list.
-  */
-  for (o = Z, len = 0; o; o = ONEXT(o), len++) {
-    Time    T = OTIME(o) - D_buf - R_buf * OLOAD(o);
-    Options n = option_mk(pair_mk(T, C_buf));
-
-    /* Insert n after o: */
-    ONEXT(n) = ONEXT(o);
-    ONEXT(o) = n;
-    o = n;
-    len++;
+  Batch b;
+  Job **ring;
+  int window = JOBS_PER_WORKER * threads;
+  unsigned long spawned = 0, finished = 0;
+  Input *in = NULL;
+  int i, failed = 0;
+
+  b.pool = pool_mk(threads);
+  b.stats = stats;
+  b.inplace = inplace;
+  b.engines = malloc(threads * sizeof(*b.engines));
+  ring = malloc(window * sizeof(*ring));
+  if (!b.engines || !ring) {
+    printf("[batch]: memory allocation failed.\n");
+    exit(1);
   }
-  if (debug)
-    options_show(stdout, Z, "Added buffer:\n");
+  for (i = 0; i < threads; i++)
+    engine_init(&b.engines[i], tech);
 
-  Z = options_filter(Z, len);
-#else
-  /* Determine Tmax: */
-
-  /* Get reference time by adding buffer to first option element: */
-  o = Z;
-  Tmax = OTIME(o) - D_buf - R_buf * OLOAD(o);
-  /* Compare against rest of elements if any: */
-  o = ONEXT(o);
-  len = 1;
-  while (o) {
-    /* Get effect of adding buffer to this option element: */
-    Time T = OTIME(o) - D_buf - R_buf * OLOAD(o);
-
-    if (T > Tmax)
-      Tmax = T;
-    o = ONEXT(o);
-    len++;
-  }
-  /* Note: Tmax <= OTIME(o) for some o elem Z. */
-
-  /* Find location to (possibly) insert buffer option (Tmax,C_buf): */
-  tail = &Z;
-  o = *tail;
-  while (OTIME(o) < Tmax) {
-    tail = &ONEXT(o);
-    o = *tail;
-  }
-  /* Here: must have Tmax <= OTIME(o) */
-
-  if (EQUAL(OTIME(o), Tmax)) {
-    /* Prune the existing option or the buffer option: */
-    if (C_buf < OLOAD(o))
-      /* This element o becomes the buffer option: */
-      OLOAD(o) = C_buf;
-    /* else discard buffer option. */
+  if (!nfiles) {
+    in = input_open(NULL);
+    in->inplace = inplace;
   }
-  else { /* Here: Tmax < OTIME(o) */
-    if (C_buf < OLOAD(o)) {
-      /* Insert buffer option before element o: */
-      *tail = option_mk(pair_mk(Tmax, C_buf));
-      ONEXT(*tail) = o;
+  for (i = 0; ; i++) {
+    Job *j;
+    FTree f = NULL;
+
+    if (nfiles ? i == nfiles : !(f = parse_next(in)))
+      break;
+    if (!(j = malloc(sizeof(*j)))) {
+      printf("[batch]: memory allocation failed.\n");
+      exit(1);
     }
-    /* else discard buffer option. */
+    j->batch = &b;
+    j->fname = nfiles ? files[i] : NULL;
+    j->f = f;
+    j->failed = 0;
+
+    /* Keep the number of jobs in flight bounded: */
+    if (spawned - finished == (unsigned long) window)
+      failed += job_finish(ring[finished++ % window]);
+    ring[spawned++ % window] = j;
+    pool_spawn(b.pool, &j->task, job_run);
   }
-  if (debug)
-    options_show(stdout, Z, "Added buffer:\n");
-#endif
-  return Z;
+  while (finished < spawned)
+    failed += job_finish(ring[finished++ % window]);
+  if (in)
+    input_close(in);
+
+  for (i = 0; i < threads; i++)
+    engine_done(&b.engines[i]);
+  free(b.engines);
+  free(ring);
+  pool_free(b.pool);
+  return failed;
 }
 
-
-
-/* (FILLED BY YOU) */
-inline static Options
-options_merge(Options o1, Options o2)
+/* Returns the field of technology t for parameter p of sweep_names. */
+static double *
+tech_param(Tech *t, int p)
 {
-  /*Find merged capacitive loading and RAT of the combined solution
-  Note you can make use of the function option_mk here to allocate new solution*/
-  Time T;
-  Capacitance L;
-  /*
-  if (OTIME(o1) < OTIME(o2))
-    T = OTIME(o1);
-  else
-    T = OTIME(o2);
-  */
-  if (my_debug) {
-    options_show(stderr, o1, "options_merge o1:");  
-    options_show(stderr, o2, "options_merge o2:");  
+  switch (p) {
+  case 0: return &t->R_unit;
+  case 1: return &t->C_unit;
+  case 2: return &t->R_buf;
+  case 3: return &t->C_buf;
+  default: return &t->D_buf;
   }
-  
-  T = min(OTIME(o1), OTIME(o2));
-  L = OLOAD(o1) + OLOAD(o2);
-
-  if(my_debug) fprintf(stderr, "options_merge output: (%2f, %2f)\n\n", T, L);
-
-  return option_mk(pair_mk(T, L));
-} 
+}
 
-/*
-   Cartesian product of option sets with on-the-fly pruning.
-   Update rules:
+/* Sets the range of ranges for the parameter in spec, which is of the form
+   name=value or name=from:to:steps. Returns 0 when spec is not valid.
+*/
+static int
+range_parse(const char *spec, Range *ranges)
+{
+  const char *eq = strchr(spec, '=');
+  char *end;
+  Range r;
+  int p;
+
+  if (!eq)
+    return 0;
+  for (p = 0; p < SWEEP_PARAMS; p++)
+    if (strlen(sweep_names[p]) == (size_t) (eq - spec)
+	&& !strncmp(spec, sweep_names[p], eq - spec))
+      break;
+  if (p == SWEEP_PARAMS)
+    return 0;
+  r.from = r.to = strtod(eq + 1, &end);
+  r.steps = 1;
+  if (end == eq + 1)
+    return 0;
+  if (*end == ':') {
+    const char *to = end + 1;
+
+    r.to = strtod(to, &end);
+    if (end == to || *end != ':')
+      return 0;
+    r.steps = strtoul(end + 1, &end, 10);
+  }
+  if (*end || r.steps < 1 || r.from < 0.0 || r.to < 0.0)
+    return 0;
+  ranges[p] = r;
+  return 1;
+}
 
-   T = min(T1, T2)
-   L = L1 + L2
+/* Returns value k of range r. */
+static double
+range_value(const Range *r, unsigned long k)
+{
+  return r->steps > 1 ? r->from + (r->to - r->from) * k / (r->steps - 1)
+    : r->from;
+}
 
-   Returns freshly created options list Z.
+/* Solves the tree of the sweep of point t with the engine of the worker
+   that runs it, set to the parameter values of t.
 */
-static Options
-options_combine(Options Z1, Options Z2)
+static void
+point_run(Task *t)
 {
-  Options Z, o1, o2;
-  Options *tail;
-  Nat len=0;
-  /* Combine every option element from Z1 with every option element from
-     Z2. The merge operation is symmetric so this approach is sufficient
-     to generate all possible combinations. The merge results are stored
-     in a new list Z.
-     Of course this list need not be ordered and very likely contains
-     redundant options, therefore must explicitly sort/filter the list.
-  */
-
-  tail=&Z;
-  for (o1 = Z1; o1; o1 = ONEXT(o1))
-    for (o2 = Z2; o2; o2 = ONEXT(o2)) {
-      /* Merge o1 and o2 */
-        *tail = options_merge(o1, o2); 
-        tail=&ONEXT(*tail);
-        len++;
-    }
-  if (debug) options_show(stdout, Z, "test");
+  Point *pt = (Point *) t;
+  Sweep *s = pt->sweep;
+  Engine *e = &s->engines[pool_worker(s->pool)];
+  int p;
+
+  /* Nothing in the engine depends on these, so it is kept as is: */
+  for (p = 0; p < SWEEP_PARAMS; p++)
+    *tech_param(&e->tech, p) = pt->values[p];
+  pt->r = engine_solve(e, s->f);
+}
 
-  /*   Z=*tail;*/
-  Z = options_filter(Z, len); 
+/* Prints one row of the results table: the results of point pt, which
+   stands for n points.
+*/
+static void
+point_show(FILE *fp, const Point *pt, unsigned long n)
+{
+  int p;
 
-  /* Delete original lists: */
-  options_free(Z1);
-  options_free(Z2);
-  return Z;
+  for (p = 0; p < SWEEP_PARAMS; p++)
+    fprintf(fp, "%-10g", pt->values[p]);
+  fprintf(fp, "%12.2f%12.2f%12.2f%12.2f%8lu\n", PTIME(pt->r.nb),
+	  PLOAD(pt->r.nb), PTIME(pt->r.best), PLOAD(pt->r.best), n);
 }
-/************************************************/
 
-/* It is assumed that option lists are < sorted w.r.t. both time and load
-   values. For any two elements (a1,b1) and (a2,b2) in the list we have
-   that if (a1,b1) appears before (a2,b2) then a1 < a2 and b1 < b2.
+/* Are the results of points x and y within tol of each other, in all
+   times and loads?
 */
+static int
+point_near(const Point *x, const Point *y, double tol)
+{
+  return NEAR(PTIME(x->r.nb), PTIME(y->r.nb), tol)
+    && NEAR(PLOAD(x->r.nb), PLOAD(y->r.nb), tol)
+    && NEAR(PTIME(x->r.best), PTIME(y->r.best), tol)
+    && NEAR(PLOAD(x->r.best), PLOAD(y->r.best), tol);
+}
 
-/* Lukas P.P.P. van Ginneken algorithm for optimal buffer insertion in
-   RC-tree.
+/* Solves flat tree f for every point of the grid given by ranges, with
+   technology tech otherwise, on `threads' threads that share the tree.
+   Prints a table of the results in grid order, the last parameter
+   varying fastest. When tol > 0, consecutive points whose results are
+   within tol of those of the first of them share its row, which counts
+   them. Returns the number of points.
 */
-static Options
-bottom_up(Tree k, Bool no_buf)
+static unsigned long
+sweep(FTree f, const Tech *tech, const Range *ranges, int threads,
+      double tol)
 {
- Options Z, Z1, Z2;
+  Sweep s;
+  Point *points;
+  unsigned long i, n = 1, first = 0;
+  int p;
+
+  for (p = 0; p < SWEEP_PARAMS; p++)
+    n *= ranges[p].steps;
+  s.pool = pool_mk(threads);
+  s.engines = malloc(threads * sizeof(*s.engines));
+  s.f = f;
+  points = malloc(n * sizeof(*points));
+  if (!s.engines || !points) {
+    printf("[sweep]: memory allocation failed.\n");
+    exit(1);
+  }
+  for (p = 0; p < threads; p++)
+    engine_init(&s.engines[p], tech);
 
-  if (T_LEAF(k))
-    Z = options_sink(k);
-  else {
-    Z1 = bottom_up(T_SUB1(k), no_buf);
-    Z2 = bottom_up(T_SUB2(k), no_buf);
-    
-    /****************************/
-    /** IMPLMENT THIS FUNCTION **/
+  for (i = 0; i < n; i++) {
+    unsigned long k = i;
 
-    Z  = options_combine(Z1, Z2);
+    for (p = SWEEP_PARAMS; p-- > 0; ) {
+      points[i].values[p] = range_value(&ranges[p], k % ranges[p].steps);
+      k /= ranges[p].steps;
+    }
+    points[i].sweep = &s;
+    pool_spawn(s.pool, &points[i].task, point_run);
+  }
+
+  for (p = 0; p < SWEEP_PARAMS; p++)
+    printf("%-10s", sweep_names[p]);
+  printf("%12s%12s%12s%12s%8s\n", "nb_time", "nb_load", "best_time",
+	 "best_load", "points");
+  for (i = 0; i < n; i++) {
+    pool_wait(s.pool, &points[i].task);
+    if (tol <= 0.0 || !point_near(&points[first], &points[i], tol)) {
+      if (i > first)
+	point_show(stdout, &points[first], i - first);
+      first = i;
+    }
+  }
+  point_show(stdout, &points[first], n - first);
+
+  for (p = 0; p < threads; p++)
+    engine_done(&s.engines[p]);
+  free(s.engines);
+  free(points);
+  pool_free(s.pool);
+  return n;
+}
 
-    /***************************/
+/* Orders named tree nodes on name. */
+static int
+node_cmp(const void *x, const void *y)
+{
+  return strcmp(((const Named *) x)->name, ((const Named *) y)->name);
+}
+
+/* Solves flat tree f incrementally: prints its results, and then those
+   after each of the edits in file fname. Returns 1 on failure.
+*/
+static int
+edit(Engine *e, FTree f, const char *fname, int stats)
+{
+  Input *in = input_open(fname);
+  Tree root;
+  Named *index;
+  uint32_t i, n = F_SIZE(f);
+  int failed = 0;
+  Edit ed;
+  Result r;
+
+  if (!in) {
+    fprintf(stderr, "Cannot open file `%s' for reading.\n", fname);
+    return 1;
+  }
+  root = ftree_tree(f);
+  if (!(index = malloc(n * sizeof(*index)))) {
+    printf("[edit]: memory allocation failed.\n");
+    exit(1);
+  }
+  for (i = 0; i < n; i++) {
+    index[i].k = root - F_ROOT(f) + i;
+    index[i].name = T_NAME(index[i].k, f->names);
+    index[i].repeated = 0;
+  }
+  qsort(index, n, sizeof(*index), node_cmp);
+  /* Names need not be unique; edits to a repeated one are ambiguous: */
+  for (i = 1; i < n; i++)
+    if (!node_cmp(&index[i-1], &index[i]))
+      index[i-1].repeated = index[i].repeated = 1;
+
+  r = engine_tree_solve(e, root, f->names);
+  report(stdout, stderr, r, e, stats);
+  while (parse_edit(in, &ed)) {
+    Named key, *found;
+
+    key.name = ed.id;
+    if (!(found = bsearch(&key, index, n, sizeof(*index), node_cmp))
+	|| (ed.sink && !T_LEAF(found->k))) {
+      fprintf(stderr, "No %s `%s' in tree.\n", ed.sink ? "sink" : "node",
+	      ed.id);
+      failed = 1;
+      break;
+    }
+    if (found->repeated) {
+      fprintf(stderr, "More than one node `%s' in tree.\n", ed.id);
+      failed = 1;
+      break;
+    }
+    r = ed.sink ? engine_set_sink(e, found->k, ed.time, ed.load)
+      : engine_set_wire(e, found->k, ed.wire);
+    report(stdout, stderr, r, e, stats);
+    if (stats)
+      fprintf(stderr, "nodes recomputed: %lu\n", ENGINE_STATS(e).nodes);
   }
-  Z = options_add_wire(Z, T_WIRE(k));
-  if (!no_buf)
-    Z = options_add_buffer(Z);
-  if (debug)
-    node_options_show(stdout, Z, k);
-  return Z;
+  engine_tree_free(root);
+  free(root - F_ROOT(f));
+  free(index);
+  input_close(in);
+  return failed;
+}
+
+static void
+usage(const char *prog)
+{
+  fprintf(stderr, "Usage: %s [-stprxw] [-l lib] [-a tol] [-k cap] [-m slew]"
+	  " [-M mb]\n"
+	  "       [-j threads] [-b binfile] [-e edits] [file]\n", prog);
+  fprintf(stderr, "       %s -S [-stp] [-l lib] [-a tol] [-k cap] [-m slew]"
+	  " [file]\n", prog);
+  fprintf(stderr, "       %s -B [-srw] [-l lib] [-a tol] [-k cap] [-m slew]"
+	  " [-M mb]\n"
+	  "       [-j threads] [file...]\n", prog);
+  fprintf(stderr, "       %s -g name=from:to:steps... [-tw] [-c tol] [-a tol]"
+	  " [-k cap]\n"
+	  "       [-m slew] [-M mb] [-j threads] [file]\n", prog);
+  fprintf(stderr, "  -s  report arena peak bytes per net on stderr\n");
+  fprintf(stderr, "  -t  report times and work counts on stderr\n");
+  fprintf(stderr, "  -p  report list length histograms, stage times and\n");
+  fprintf(stderr, "      the nodes with the most options on stderr\n");
+  fprintf(stderr, "  -x  solve with the generic code, even when there is code\n");
+  fprintf(stderr, "      specialized for the technology (for comparison)\n");
+  fprintf(stderr, "  -r  also print where the buffers go, by the name of the\n");
+  fprintf(stderr, "      node whose wire each one drives (not with -e)\n");
+  fprintf(stderr, "  -w  take node names in place from the input text instead\n");
+  fprintf(stderr, "      of storing each distinct one once; parses faster, but\n");
+  fprintf(stderr, "      keeps all of the text while the tree is in use\n");
+  fprintf(stderr, "  -l  use the buffer types in file lib; those whose name\n");
+  fprintf(stderr, "      starts with '~' are inverters\n");
+  fprintf(stderr, "  -a  approximate: drop options within tol in time and\n");
+  fprintf(stderr, "      load of a better one\n");
+  fprintf(stderr, "  -k  approximate: keep at most cap > 1 options per node\n");
+  fprintf(stderr, "      (with -a or -k, a single tree is also solved exactly\n");
+  fprintf(stderr, "      to report the slack lost on stderr)\n");
+  fprintf(stderr, "  -m  keep the slew, ln(9) times driver resistance times\n");
+  fprintf(stderr, "      load, of every stage within slew\n");
+  fprintf(stderr, "  -M  keep solved subtrees in up to mb megabytes, lookup\n");
+  fprintf(stderr, "      data included, to reuse for identical ones instead\n");
+  fprintf(stderr, "      of solving them again (not with -r; solves serially)\n");
+  fprintf(stderr, "  -j  solve subtrees in parallel on this many threads,\n");
+  fprintf(stderr, "      or with -B or -g, this many nets or parameter\n");
+  fprintf(stderr, "      combinations at the same time\n");
+  fprintf(stderr, "  -b  write tree in binary format to binfile and exit\n");
+  fprintf(stderr, "  -e  apply the edits in file edits one by one, solving\n");
+  fprintf(stderr, "      incrementally and printing the results after each\n");
+  fprintf(stderr, "      (not with -j; edited nodes need unique names)\n");
+  fprintf(stderr, "  -B  batch mode: solve all trees in all files (or in\n");
+  fprintf(stderr, "      stdin), printing results in input order\n");
+  fprintf(stderr, "  -S  stream: solve the tree while reading it, in memory\n");
+  fprintf(stderr, "      that grows with its depth only (text trees only;\n");
+  fprintf(stderr, "      no slack loss report)\n");
+  fprintf(stderr, "  -g  sweep: solve the tree for steps values from from to\n");
+  fprintf(stderr, "      to of parameter name, one of R_unit, C_unit, R_buf,\n");
+  fprintf(stderr, "      C_buf and D_buf (or for name=value, that value);\n");
+  fprintf(stderr, "      with more -g, for all combinations of them,\n");
+  fprintf(stderr, "      printing a table of the results\n");
+  fprintf(stderr, "  -c  with -g, print consecutive combinations whose\n");
+  fprintf(stderr, "      results are within tol of each other as one row\n");
+  exit(EXIT_FAILURE);
 }
 
 int
 main(int argc, char *argv[])
 {
-  Tree t;
+  FTree t;
+  const char *binfile = NULL, *edits = NULL;
+  Tech tech = tech_default;
+  Range ranges[SWEEP_PARAMS];
+  double collapse = 0.0;
+  Input *in;
+  int threads = 1, swept = 0;
+  int stats = 0, batched = 0, streamed = 0, measure = 0;
+#ifndef NPROFILE
+  int profile = 0;
+#endif
+  int inplace = 0;
+  double start, parsed, solved;
+  Engine engine;
+  Result r;
+  int c;
+
+  for (c = 0; c < SWEEP_PARAMS; c++)
+    ranges[c].steps = 0;
+  while ((c = getopt(argc, argv, "stprxwl:a:k:m:M:j:b:e:g:c:BS")) != -1)
+    switch (c) {
+    case 's':
+      stats = 1;
+      break;
+    case 't':
+      measure = 1;
+      break;
+    case 'p':
+#ifdef NPROFILE
+      fprintf(stderr, "Profiling was compiled out (NPROFILE).\n");
+      return EXIT_FAILURE;
+#else
+      profile = 1;
+      break;
+#endif
+    case 'r':
+      tech.trace = 1;
+      break;
+    case 'x':
+      tech.generic = 1;
+      break;
+    case 'w':
+      inplace = 1;
+      break;
+    case 'l':
+      /* Buffer names point into the input, which therefore stays open: */
+      if (!(in = input_open(optarg))) {
+	fprintf(stderr, "Cannot open file `%s' for reading.\n", optarg);
+	return EXIT_FAILURE;
+      }
+      tech.lib = parse_library(in, &tech.nlib);
+      if (!tech.nlib) {
+	fprintf(stderr, "No buffer types in `%s'.\n", optarg);
+	return EXIT_FAILURE;
+      }
+      break;
+    case 'a':
+      if ((tech.tol = atof(optarg)) <= 0.0)
+	usage(argv[0]);
+      break;
+    case 'k':
+      if ((tech.cap = atoi(optarg)) < 2)
+	usage(argv[0]);
+      break;
+    case 'm':
+      if ((tech.slew = atof(optarg)) <= 0.0)
+	usage(argv[0]);
+      break;
+    case 'M':
+      if (atof(optarg) <= 0.0)
+	usage(argv[0]);
+      tech.memo = atof(optarg) * 1024 * 1024;
+      break;
+    case 'j':
+      if ((threads = atoi(optarg)) < 1)
+	usage(argv[0]);
+      break;
+    case 'b':
+      binfile = optarg;
+      break;
+    case 'e':
+      edits = optarg;
+      break;
+    case 'g':
+      if (!range_parse(optarg, ranges))
+	usage(argv[0]);
+      swept = 1;
+      break;
+    case 'c':
+      if ((collapse = atof(optarg)) <= 0.0)
+	usage(argv[0]);
+      break;
+    case 'B':
+      batched = 1;
+      break;
+    case 'S':
+      streamed = 1;
+      break;
+    default:
+      usage(argv[0]);
+    }
+
+  if (tech.memo && tech.trace)
+    usage(argv[0]);
+  if (swept) {
+    /* Buffer parameters are of no use with a library: */
+    if (tech.trace || binfile || edits || batched || streamed
+	|| optind + 1 < argc
+	|| (tech.nlib && (ranges[2].steps || ranges[3].steps
+			  || ranges[4].steps)))
+      usage(argv[0]);
+    for (c = 0; c < SWEEP_PARAMS; c++)
+      if (!ranges[c].steps) {
+	ranges[c].from = ranges[c].to = *tech_param(&tech, c);
+	ranges[c].steps = 1;
+      }
+  }
+  else if (collapse > 0.0)
+    usage(argv[0]);
+  if (batched) {
+    if (measure || binfile || edits)
+      usage(argv[0]);
+#ifndef NPROFILE
+    if (profile)
+      usage(argv[0]);
+#endif
+    return batch(argv + optind, argc - optind, &tech, threads, stats, inplace)
+      ? EXIT_FAILURE : EXIT_SUCCESS;
+  }
+
+  if (streamed) {
+    if (tech.trace || tech.memo || threads > 1 || binfile || edits || inplace
+	|| optind + 1 < argc)
+      usage(argv[0]);
+    engine_init(&engine, &tech);
+    c = stream(&engine, optind < argc ? argv[optind] : NULL, stats, measure);
+#ifndef NPROFILE
+    if (!c && profile)
+      profile_show(stderr, &ENGINE_STATS(&engine));
+#endif
+    engine_done(&engine);
+    return c ? EXIT_FAILURE : EXIT_SUCCESS;
+  }
 
-  if (argc > 1 && argv[1])
-    if (!freopen(argv[1], "r", stdin)) {
-      fprintf(stderr, "Cannot open file `%s' for reading.\n", argv[1]);
+  if (optind < argc)
+    if (!freopen(argv[optind], "r", stdin)) {
+      fprintf(stderr, "Cannot open file `%s' for reading.\n", argv[optind]);
       return EXIT_FAILURE;
     }
 
-  t = parse();
+  start = now();
+  t = parse_flat(inplace);
+  parsed = now() - start;
+
+  if (swept) {
+    unsigned long n;
+
+    start = now();
+    n = sweep(t, &tech, ranges, threads, collapse);
+    if (measure)
+      fprintf(stderr, "points=%lu threads=%d parse_s=%.6f sweep_s=%.6f\n",
+	      n, threads, parsed, now() - start);
+    return EXIT_SUCCESS;
+  }
+
+  if (binfile) {
+    FILE *fp = fopen(binfile, "wb");
 
-  pair_show(stdout, OPAIR(bottom_up(t, 1)));
-  fprintf(stdout, "\n");
-  pair_show(stdout, OPAIR(options_last(bottom_up(t, 0))));
-  fprintf(stdout, "\n");
+    if (!fp || bintree_write(fp, t) || fclose(fp)) {
+      fprintf(stderr, "Cannot write file `%s'.\n", binfile);
+      return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+  }
+
+  if (edits && (tech.trace || threads > 1))
+    usage(argv[0]);
+  engine_init(&engine, &tech);
+  if (edits) {
+    c = edit(&engine, t, edits, stats);
+    engine_done(&engine);
+    return c ? EXIT_FAILURE : EXIT_SUCCESS;
+  }
+  start = now();
+  if (threads > 1) {
+    Pool *pool = pool_mk(threads);
+
+    r = engine_solve_par(&engine, t, pool);
+    pool_free(pool);
+  }
+  else
+    r = engine_solve(&engine, t);
+  solved = now() - start;
+  report(stdout, stderr, r, &engine, stats);
+  if (measure)
+    measure_show(stderr, F_SIZE(t), sinks_count(t), &engine, parsed, solved);
+  if (tech.tol > 0.0 || tech.cap)
+    loss_show(stderr, t, &tech, r);
+#ifndef NPROFILE
+  if (profile)
+    profile_show(stderr, &ENGINE_STATS(&engine));
+#endif
+  engine_done(&engine);
 
   return EXIT_SUCCESS;
 }
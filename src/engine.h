@@ -0,0 +1,279 @@
+/* Copyright (c) 2003 ACM/SIGDA
+   Prepared by Geert Janssen, geert@us.ibm.com
+*/
+
+#ifndef ENGINE_H
+#define ENGINE_H
+
+/* ------------------------------------------------------------------------ */
+/* INCLUDES								    */
+/* ------------------------------------------------------------------------ */
+
+#include "tree.h"
+#include "arena.h"
+#include "pool.h"
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+/* ------------------------------------------------------------------------ */
+/* DEFINES								    */
+/* ------------------------------------------------------------------------ */
+
+/* Accuracy in comparing two floating point numbers for equality. */
+#define EPS		1e-5
+/* Whether a and b differ by less than tol, and by less than EPS resp.: */
+#define NEAR(a,b,tol)	(fabs((a) - (b)) < (tol))
+#define EQUAL(a,b)	NEAR(a, b, EPS)
+
+/* Pair field access macros: */
+#define PTIME(x)	((x).T)
+#define PLOAD(x)	((x).L)
+
+/* Arena bytes used at most while solving the last tree: */
+#define ENGINE_PEAK(e)	ARENA_PEAK(&(e)->arena)
+/* Number of times the engine's arena had to grow: */
+#define ENGINE_GROWS(e)	ARENA_GROWS(&(e)->arena)
+/* Work counts of the last tree solved: */
+#define ENGINE_STATS(e)	((e)->stats)
+
+/* Histogram size and number of worst nodes kept when profiling, and the
+   longest part of their names kept:
+*/
+#define PROFILE_BUCKETS	24
+#define PROFILE_TOP	10
+#define PROFILE_NAME	64
+
+/* ------------------------------------------------------------------------ */
+/* TYPE DEFINITIONS							    */
+/* ------------------------------------------------------------------------ */
+
+typedef double		Time;
+typedef double		Capacitance;
+typedef double		Resistance;
+typedef double		Length;
+
+/* An option pair. */
+typedef struct Pair_S {
+  Time T;			/* required arrival time */
+  Capacitance L;		/* overall capacitive load */
+} Pair;
+
+/* A buffer type. */
+typedef struct Buffer_S {
+  const char *id;		/* name */
+  Resistance R;			/* [Ohm] */
+  Capacitance C;		/* [fF] */
+  Time D;			/* [ns] */
+  int inverts;			/* an inverter */
+} Buffer;
+
+/* Technology parameters. */
+typedef struct Tech_S {
+  /* Per unit wire length resistance and capacitance values: */
+  Resistance  R_unit;		/* [Ohm/m] */
+  Capacitance C_unit;		/* [F/m] */
+  /* Buffer parameters: */
+  Resistance  R_buf;		/* [Ohm] */
+  Capacitance C_buf;		/* [fF] */
+  Time        D_buf;		/* [ns] */
+  /* Buffer library; when it is not empty, it replaces the buffer above: */
+  const Buffer *lib;
+  int nlib;
+  /* Approximate pruning, both 0 for exact solutions: options within tol
+     in time and load of a better one are dropped, and at most cap > 1
+     options are kept per node.
+  */
+  double tol;
+  int cap;
+  /* Keep back-references so that engine_buffers can tell where the
+     buffers of the best solution go:
+  */
+  int trace;
+  /* Largest slew allowed at the input of a buffer or sink, 0 for none.
+     The slew of a stage is taken as ln(9) times the resistance of its
+     driver times its load, and its source as no stronger than the
+     strongest buffer.
+  */
+  Time slew;			/* [ns] */
+  /* Bytes to keep the solutions of solved subtrees in, so that identical
+     subtrees later in the same tree reuse them, 0 for none. The lookup
+     data, 16 bytes per node of the tree, counts too; a tree too large for
+     it is solved without. Not used when tracing, as buffer locations
+     depend on node names.
+  */
+  size_t memo;
+  /* Solve with the generic code even when there is code specialized for
+     the technology, see engine_solve; for comparing the two:
+  */
+  int generic;
+} Tech;
+
+/* Solutions at the root of a tree. With inverters, only those that
+   deliver the signal to the sinks as is count.
+*/
+typedef struct Result_S {
+  Pair nb;			/* without any buffers */
+  Pair best;			/* with buffers, for the largest time; its
+				   time is -HUGE_VAL if none meets the slew
+				   limit */
+} Result;
+
+#ifndef NPROFILE
+/* Per-node measurements of a solve; define NPROFILE to compile them out.
+   Histogram bucket b > 0 counts lists with a length in [2^(b-1),2^b),
+   and bucket 0 counts empty lists.
+*/
+typedef struct Profile_S {
+  unsigned long filter_in[PROFILE_BUCKETS];  /* lengths before filtering */
+  unsigned long filter_out[PROFILE_BUCKETS]; /* lengths after filtering */
+  unsigned long combine_in[PROFILE_BUCKETS]; /* lengths of combined lists */
+  double wire_s, buffer_s, combine_s;	     /* time per stage */
+  struct {
+    char id[PROFILE_NAME];	/* node name, copied as it may not last */
+    unsigned long len;		/* length of its options list */
+  } top[PROFILE_TOP];		/* nodes with the longest lists, longest first */
+  int ntop;
+} Profile;
+#endif
+
+/* Work counts of a solve. */
+typedef struct Stats_S {
+  unsigned long nodes;		/* nodes solved */
+  unsigned long options;	/* sum of options list lengths over nodes */
+  unsigned long max_options;	/* longest options list of a node */
+  unsigned long memo_hits;	/* subtrees whose solutions were reused */
+  unsigned long memo_misses;	/* subtrees solved and kept for reuse */
+  int specialized;		/* by code specialized for the technology */
+#ifndef NPROFILE
+  Profile prof;
+#endif
+} Stats;
+
+/* What an option was made of: the two options combined into it, or the
+   option a buffer was added to. Number 0 stands for the options without
+   any buffers below them.
+*/
+typedef struct Trace_S {
+  unsigned int from1;		/* trace of the (first) option */
+  unsigned int from2;		/* trace of the second one, or buffer type */
+  const char *id;		/* node with the buffer, or NULL if combined */
+} Trace;
+
+/* Back-references of a solve. Trace records are shared between all
+   options that have the same history, and only made when options are
+   combined that both have buffers below them, or when a buffer is added.
+*/
+typedef struct Trail_S {
+  unsigned int *ids;		/* trace of each options list slot */
+  size_t cap;			/* number of slots */
+  Arena traces;			/* Trace records */
+  unsigned int best;		/* trace of the best root option */
+} Trail;
+
+/* All state for solving trees: one engine can solve one tree at a time,
+   and different engines can be used by different threads at the same
+   time. Memory is kept for reuse from one tree to the next.
+*/
+typedef struct Engine_S {
+  Tech tech;			/* technology parameters */
+  Buffer *lib;			/* sorted copy of the buffer library */
+  Arena arena;			/* options lists */
+  Stats stats;			/* of the last tree solved */
+  Trail trail;			/* of the last tree solved, if tracing */
+  struct Memo_S *memo;		/* solved subtrees, if memoizing */
+  struct Solution_S *pending;	/* subtrees streamed but not consumed yet */
+  unsigned npending, pending_cap;
+  const Names *names;		/* of the pointer tree solved */
+} Engine;
+
+/* ------------------------------------------------------------------------ */
+/* VARIABLES								    */
+/* ------------------------------------------------------------------------ */
+
+/* The technology that was traditionally hard-coded. */
+extern const Tech tech_default;
+
+/* ------------------------------------------------------------------------ */
+/* FUNCTION PROTOTYPES							    */
+/* ------------------------------------------------------------------------ */
+
+/* Prints pair p as "(T, L)" to fp. */
+void pair_show(FILE *fp, Pair p);
+
+#ifndef NPROFILE
+/* Prints the profile in stats st as a table to fp. */
+void profile_show(FILE *fp, const Stats *st);
+#endif
+
+/* Initializes engine e for technology tech. */
+void engine_init(Engine *e, const Tech *tech);
+
+/* Releases the memory held by engine e. */
+void engine_done(Engine *e);
+
+/* Returns the root solutions of flat tree f, using van Ginneken's
+   buffer insertion algorithm.
+   The engine is compiled with code specialized for a few technologies
+   without library, approximation or slew limit: the default one, and the
+   one whose R_unit, C_unit, R_buf, C_buf and D_buf are given by macro
+   TECH_FIXED, if defined. Trees are solved by that code when the
+   technology is one of them; define NSPECIALIZE to leave it out.
+*/
+Result engine_solve(Engine *e, FTree f);
+
+/* As engine_solve, but solves large subtrees in parallel with the workers
+   of pool. Must be called from a worker thread of pool. The result is
+   identical to engine_solve's. Solves serially when tracing or memoizing.
+*/
+Result engine_solve_par(Engine *e, FTree f, Pool *pool);
+
+/* Solving a tree while it is being read, without keeping it:
+   after engine_stream_start, the nodes of the tree are passed one by one
+   in post-order, with engine_stream_leaf for a sink and with
+   engine_stream_node for an internal node, whose nsub subtrees are the
+   nsub most recent ones passed that have no parent yet. Names need only be
+   valid during the call. Once the root has been passed, engine_stream_end
+   returns the root solutions, as engine_solve would for the whole tree;
+   engine_stream_abort instead drops whatever was passed so far.
+   Tracing and memoizing are not supported.
+*/
+void engine_stream_start(Engine *e);
+void engine_stream_leaf(Engine *e, const char *id, double wire, double time,
+			double load);
+void engine_stream_node(Engine *e, const char *id, double wire,
+			unsigned nsub);
+Result engine_stream_end(Engine *e);
+void engine_stream_abort(Engine *e);
+
+/* Calls emit for every buffer of the best solution of the last tree
+   solved by engine_solve or engine_solve_par, with the name of the node
+   whose wire the buffer drives and its type, NULL for the buffer of the
+   technology without a library. Requires tracing, and the tree must not
+   have been freed.
+*/
+void engine_buffers(Engine *e,
+		    void (*emit)(const char *id, const Buffer *b, void *arg),
+		    void *arg);
+
+/* Incremental solving of pointer trees:
+   engine_tree_solve solves tree t, whose names are in table names, as
+   engine_solve does, but keeps the solutions for the subtree of every
+   node in its T_DATA slot. After that,
+   engine_set_sink and engine_set_wire change the sink data of leaf k or
+   the wire of node k of the tree, and only recompute the solutions on
+   the path from k to the root, up to the first node whose solutions do
+   not change. All return the root solutions; engine statistics count the
+   nodes recomputed. engine_tree_free releases the kept solutions.
+*/
+Result engine_tree_solve(Engine *e, Tree t, const Names *names);
+Result engine_set_sink(Engine *e, Tree k, double time, double load);
+Result engine_set_wire(Engine *e, Tree k, double wire);
+void engine_tree_free(Tree t);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ENGINE_H */
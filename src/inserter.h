@@ -0,0 +1,63 @@
+/* Copyright (c) ACM/SIGDA
+   Prepared by Geert Janssen, geert@us.ibm.com
+*/
+
+#ifndef INSERTER_H
+#define INSERTER_H
+
+/* ------------------------------------------------------------------------ */
+/* INCLUDES								    */
+/* ------------------------------------------------------------------------ */
+
+#include "engine.h"
+
+/* ------------------------------------------------------------------------ */
+/* TYPE DEFINITIONS							    */
+/* ------------------------------------------------------------------------ */
+
+/* The optimizer for programs that build their nets in memory, such as
+   placement tools, rather than having them parsed from text:
+   a BufferInserter solves one net after another for a fixed technology,
+   with all memory kept for reuse from one net to the next, so that small
+   nets cost little more than the solving itself. Different inserters can
+   be used by different threads at the same time.
+*/
+class BufferInserter {
+public:
+  /* Makes an inserter for technology tech; any buffer library of tech is
+     copied.
+  */
+  explicit BufferInserter(const Tech &tech = tech_default);
+  ~BufferInserter();
+
+  /* Returns the root solutions of tree t, which is left unchanged, with
+     its names in table names.
+  */
+  Result optimize(const Tree &t, Names *names);
+
+  /* Returns the root solutions of flat tree f. */
+  Result optimize(FTree f);
+
+  /* Calls emit for every buffer of the best solution of the last net, as
+     engine_buffers does. Requires tracing in the technology, and the net
+     must still exist.
+  */
+  void buffers(void (*emit)(const char *id, const Buffer *b, void *arg),
+	       void *arg);
+
+  /* The technology, with the library sorted on capacitance: */
+  const Tech &tech() const { return engine.tech; }
+
+  /* Work counts of the last net: */
+  const Stats &stats() const { return ENGINE_STATS(&engine); }
+
+private:
+  Engine engine;
+  FTree flat;			/* last pointer tree, flattened */
+
+  /* Engines own memory, and are not copied: */
+  BufferInserter(const BufferInserter &);
+  BufferInserter &operator=(const BufferInserter &);
+};
+
+#endif /* INSERTER_H */
@@ -0,0 +1,335 @@
+/* Copyright (c) 2003 ACM/SIGDA
+   Prepared by Geert Janssen, geert@us.ibm.com
+*/
+
+/* ------------------------------------------------------------------------ */
+/* INCLUDES                                                                 */
+/* ------------------------------------------------------------------------ */
+
+#include <math.h>
+#include <pthread.h>
+#include "kernels.h"
+
+/* x86 vector versions, selected at run-time; the compiler needs no flags: */
+#if defined __GNUC__ && defined __x86_64__
+#define KERNELS_X86
+#include <immintrin.h>
+#endif
+
+/* ------------------------------------------------------------------------ */
+/* LOCAL DEFINES                                                            */
+/* ------------------------------------------------------------------------ */
+
+#define max(a,b)	((a) > (b) ? (a) : (b))
+
+/* Compiles a function for instruction set isa, which may have fused
+   multiply-add: keep the compiler from using it, as the scalar versions
+   round the product first.
+*/
+#define VECTOR(isa) \
+  __attribute__ ((target (isa), optimize ("fp-contract=off")))
+
+/* ------------------------------------------------------------------------ */
+/* VARIABLES		                                                    */
+/* ------------------------------------------------------------------------ */
+
+static void scalar_add_wire(Pair *p, size_t n, Time D, Resistance R,
+			    Capacitance C);
+static Time scalar_buffered_max(const Pair *p, size_t n, Resistance R, Time D);
+static size_t scalar_filter(Pair *p, size_t n, Resistance R);
+
+static const Kernels kernels_scalar = {
+  "scalar", scalar_add_wire, scalar_buffered_max, scalar_filter
+};
+
+const Kernels *kernels = &kernels_scalar;
+
+/* ------------------------------------------------------------------------ */
+/* FUNCTION DEFINITIONS                                                     */
+/* ------------------------------------------------------------------------ */
+
+/* The vector versions evaluate the very same expressions as these, in
+   the same order and without fused multiply-add, so that results are
+   identical.
+*/
+
+static void
+scalar_add_wire(Pair *p, size_t n, Time D, Resistance R, Capacitance C)
+{
+  size_t i;
+
+  for (i = 0; i < n; i++) {
+    PTIME(p[i]) -= D + R * PLOAD(p[i]);
+    PLOAD(p[i]) += C;
+  }
+}
+
+static Time
+scalar_buffered_max(const Pair *p, size_t n, Resistance R, Time D)
+{
+  Time Tmax = PTIME(p[0]) - D - R * PLOAD(p[0]);
+  size_t i;
+
+  for (i = 1; i < n; i++) {
+    Time T = PTIME(p[i]) - D - R * PLOAD(p[i]);
+
+    if (T > Tmax)
+      Tmax = T;
+  }
+  return Tmax;
+}
+
+/* Keeps options p[i..n-1] that improve by more than EPS on the time of the
+   last one kept, p[m-1], appending them at p[m]; times are taken less R
+   times the load. Returns the new m.
+   Options are only moved once one has been dropped: storing an option
+   over itself would just delay reading it back.
+   Inlined into the vector versions, so that these do not switch between
+   vector and scalar instruction encodings, which can be expensive.
+*/
+static inline size_t
+filter_tail(Pair *p, size_t i, size_t n, size_t m, Resistance R)
+{
+  Time last = PTIME(p[m-1]) - R * PLOAD(p[m-1]);
+
+  for (; i < n; i++) {
+    Time T = PTIME(p[i]) - R * PLOAD(p[i]);
+
+    if (T > last && !EQUAL(T, last)) {
+      last = T;
+      if (m != i)
+	p[m] = p[i];
+      m++;
+    }
+  }
+  return m;
+}
+
+static size_t
+scalar_filter(Pair *p, size_t n, Resistance R)
+{
+  return filter_tail(p, 1, n, 1, R);
+}
+
+#ifdef KERNELS_X86
+/* Vectors hold whole pairs: the even elements are times, the odd ones
+   loads. Swapping the two within every pair lines up each time with its
+   own load.
+
+   The filter works on blocks of options: the times of a block are
+   gathered into one vector, and the running maximum time before each of
+   them is a prefix maximum. As long as every option either improves on
+   that maximum by at least EPS or does not improve on it at all, the
+   options kept are exactly the improving ones. Otherwise an option would
+   be dropped although it raises the maximum, which the prefix maximum
+   does not know about, and the block is done the scalar way. Blocks start
+   at the first option, kept like any other as nothing comes before it, so
+   that their loads line up with the stores of add_wire just before;
+   loads straddling two of these wait for both to reach the cache.
+*/
+
+VECTOR ("avx2")
+static void
+avx2_add_wire(Pair *p, size_t n, Time D, Resistance R, Capacitance C)
+{
+  __m256d r = _mm256_set1_pd(R), c = _mm256_set1_pd(C);
+  __m256d dd = _mm256_set1_pd(D);
+  double *d = (double *) p;
+  size_t i;
+
+  for (i = 0; i + 2 <= n; i += 2) {
+    __m256d v = _mm256_loadu_pd(d + 2 * i);
+    __m256d l = _mm256_permute_pd(v, 0x5);
+    __m256d t = _mm256_sub_pd(v, _mm256_add_pd(dd, _mm256_mul_pd(r, l)));
+
+    _mm256_storeu_pd(d + 2 * i, _mm256_blend_pd(t, _mm256_add_pd(v, c), 0xA));
+  }
+  scalar_add_wire(p + i, n - i, D, R, C);
+}
+
+VECTOR ("avx2")
+static Time
+avx2_buffered_max(const Pair *p, size_t n, Resistance R, Time D)
+{
+  __m256d r = _mm256_set1_pd(R), dd = _mm256_set1_pd(D);
+  __m256d m = _mm256_set1_pd(-HUGE_VAL);
+  const double *d = (const double *) p;
+  double lanes[4];
+  Time Tmax;
+  size_t i;
+
+  for (i = 0; i + 2 <= n; i += 2) {
+    __m256d v = _mm256_loadu_pd(d + 2 * i);
+    __m256d l = _mm256_permute_pd(v, 0x5);
+
+    m = _mm256_max_pd(m, _mm256_sub_pd(_mm256_sub_pd(v, dd),
+				       _mm256_mul_pd(r, l)));
+  }
+  _mm256_storeu_pd(lanes, m);
+  Tmax = max(lanes[0], lanes[2]);
+  if (i < n)
+    Tmax = max(Tmax, scalar_buffered_max(p + i, n - i, R, D));
+  return Tmax;
+}
+
+VECTOR ("avx512f")
+static void
+avx512_add_wire(Pair *p, size_t n, Time D, Resistance R, Capacitance C)
+{
+  __m512d r = _mm512_set1_pd(R), c = _mm512_set1_pd(C);
+  __m512d dd = _mm512_set1_pd(D);
+  double *d = (double *) p;
+  size_t i;
+
+  for (i = 0; i + 4 <= n; i += 4) {
+    __m512d v = _mm512_loadu_pd(d + 2 * i);
+    __m512d l = _mm512_permute_pd(v, 0x55);
+    __m512d t = _mm512_sub_pd(v, _mm512_add_pd(dd, _mm512_mul_pd(r, l)));
+
+    _mm512_storeu_pd(d + 2 * i,
+		     _mm512_mask_blend_pd(0xAA, t, _mm512_add_pd(v, c)));
+  }
+  scalar_add_wire(p + i, n - i, D, R, C);
+}
+
+VECTOR ("avx512f")
+static Time
+avx512_buffered_max(const Pair *p, size_t n, Resistance R, Time D)
+{
+  __m512d r = _mm512_set1_pd(R), dd = _mm512_set1_pd(D);
+  __m512d m = _mm512_set1_pd(-HUGE_VAL);
+  const double *d = (const double *) p;
+  Time Tmax;
+  size_t i;
+
+  for (i = 0; i + 4 <= n; i += 4) {
+    __m512d v = _mm512_loadu_pd(d + 2 * i);
+    __m512d l = _mm512_permute_pd(v, 0x55);
+
+    m = _mm512_max_pd(m, _mm512_sub_pd(_mm512_sub_pd(v, dd),
+				       _mm512_mul_pd(r, l)));
+  }
+  Tmax = _mm512_mask_reduce_max_pd(0x55, m);
+  if (i < n)
+    Tmax = max(Tmax, scalar_buffered_max(p + i, n - i, R, D));
+  return Tmax;
+}
+
+/* Returns the vector of x's elements moved up by k places, with f's
+   elements shifted in.
+*/
+#define AVX512_SHIFT(x,f,k) \
+  _mm512_castsi512_pd(_mm512_alignr_epi64(_mm512_castpd_si512(x), \
+					  _mm512_castpd_si512(f), 8 - (k)))
+
+VECTOR ("avx512f")
+static size_t
+avx512_filter(Pair *p, size_t n, Resistance R)
+{
+  /* Each bit of a 4 bit mask of pairs doubled, giving a mask of doubles: */
+  static const unsigned char pairs[16] = {
+    0x00, 0x03, 0x0C, 0x0F, 0x30, 0x33, 0x3C, 0x3F,
+    0xC0, 0xC3, 0xCC, 0xCF, 0xF0, 0xF3, 0xFC, 0xFF
+  };
+  __m512i times = _mm512_set_epi64(14, 12, 10, 8, 6, 4, 2, 0);
+  __m512i loads = _mm512_set_epi64(15, 13, 11, 9, 7, 5, 3, 1);
+  __m512d r = _mm512_set1_pd(R);
+  __m512i last = _mm512_set1_epi64(7);
+  __m512d eps = _mm512_set1_pd(EPS), none = _mm512_set1_pd(-HUGE_VAL);
+  __m512d M = none;
+  double *d = (double *) p;
+  size_t i, m = 0;
+
+  for (i = 0; i + 8 <= n; i += 8) {
+    __m512d a = _mm512_loadu_pd(d + 2 * i);
+    __m512d b = _mm512_loadu_pd(d + 2 * i + 8);
+    __m512d t = _mm512_sub_pd(_mm512_permutex2var_pd(a, times, b),
+			      _mm512_mul_pd(r, _mm512_permutex2var_pd(a, loads,
+								      b)));
+    __m512d y = _mm512_max_pd(t, AVX512_SHIFT(t, none, 1));
+    __m512d prev;
+    __mmask8 keep, up;
+
+    y = _mm512_max_pd(y, AVX512_SHIFT(y, none, 2));
+    y = _mm512_max_pd(y, AVX512_SHIFT(y, none, 4));
+    prev = _mm512_max_pd(M, AVX512_SHIFT(y, none, 1));
+    keep = _mm512_cmp_pd_mask(_mm512_sub_pd(t, prev), eps, _CMP_GE_OQ);
+    up = _mm512_cmp_pd_mask(t, prev, _CMP_GT_OQ);
+    if (up & ~keep) {
+      m = m ? filter_tail(p, i, i + 8, m, R) : filter_tail(p, 1, 8, 1, R);
+      M = _mm512_set1_pd(PTIME(p[m-1]) - R * PLOAD(p[m-1]));
+      continue;
+    }
+    if (keep == 0xFF && m == i)
+      m += 8;
+    else {
+      /* Both halves are in registers before anything is stored, and each
+	 store ends within the block:
+      */
+      _mm512_storeu_pd(d + 2 * m, _mm512_maskz_compress_pd(pairs[keep & 0xF],
+							   a));
+      m += __builtin_popcount(keep & 0xF);
+      _mm512_storeu_pd(d + 2 * m, _mm512_maskz_compress_pd(pairs[keep >> 4],
+							   b));
+      m += __builtin_popcount(keep >> 4);
+    }
+    M = _mm512_max_pd(M, _mm512_permutexvar_pd(last, y));
+  }
+  return m ? filter_tail(p, i, n, m, R) : filter_tail(p, 1, n, 1, R);
+}
+
+/* Without a compress instruction, storing the options kept of a block
+   costs more than the scalar filter does:
+*/
+static const Kernels kernels_avx2 = {
+  "avx2", avx2_add_wire, avx2_buffered_max, scalar_filter
+};
+
+static const Kernels kernels_avx512 = {
+  "avx512", avx512_add_wire, avx512_buffered_max, avx512_filter
+};
+#endif /* KERNELS_X86 */
+
+const Kernels *
+kernels_find(const char *name)
+{
+  if (!strcmp(name, "scalar"))
+    return &kernels_scalar;
+#ifdef KERNELS_X86
+  __builtin_cpu_init();
+  if (!strcmp(name, "avx2") && __builtin_cpu_supports("avx2"))
+    return &kernels_avx2;
+  if (!strcmp(name, "avx512") && __builtin_cpu_supports("avx512f"))
+    return &kernels_avx512;
+#endif
+  return NULL;
+}
+
+/* Selects the implementation for kernels_init, exactly once. */
+static void
+kernels_select(void)
+{
+  /* The AVX-512 kernels only pay off on long lists; on the short ones of
+     most trees, the time the processor takes to power up its wide units
+     outweighs the gain:
+  */
+  static const char *const names[] = { "avx2", "scalar" };
+  const char *name = getenv("BUFFER_KERNELS");
+  const Kernels *k = NULL;
+  int i;
+
+  if (name && !(k = kernels_find(name)))
+    fprintf(stderr, "Kernels `%s' not available; selecting the best.\n",
+	    name);
+  for (i = 0; !k; i++)
+    k = kernels_find(names[i]);
+  kernels = k;
+}
+
+void
+kernels_init(void)
+{
+  static pthread_once_t once = PTHREAD_ONCE_INIT;
+
+  pthread_once(&once, kernels_select);
+}
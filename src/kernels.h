@@ -0,0 +1,70 @@
+/* Copyright (c) 2003 ACM/SIGDA
+   Prepared by Geert Janssen, geert@us.ibm.com
+*/
+
+#ifndef KERNELS_H
+#define KERNELS_H
+
+/* ------------------------------------------------------------------------ */
+/* INCLUDES								    */
+/* ------------------------------------------------------------------------ */
+
+#include "engine.h"
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+/* ------------------------------------------------------------------------ */
+/* TYPE DEFINITIONS							    */
+/* ------------------------------------------------------------------------ */
+
+/* The inner loops over options lists, as one implementation for a certain
+   instruction set. All implementations give bit-identical results.
+*/
+typedef struct Kernels_S {
+  const char *name;
+  /* Adds a wire, or a chain of wires, to the n options p: their times
+     drop by D + R * L for their loads L, which grow by C. A single wire
+     has D = R * C / 2.
+  */
+  void (*add_wire)(Pair *p, size_t n, Time D, Resistance R, Capacitance C);
+  /* Returns the largest time of the n > 0 options p when a buffer of
+     resistance R and delay D is added to them:
+  */
+  Time (*buffered_max)(const Pair *p, size_t n, Resistance R, Time D);
+  /* Drops the inferior ones of the n > 0 options p, which are sorted on
+     load, as seen through a wire of resistance R, i.e., by their times
+     less R * L for their loads L. Returns how many are left:
+  */
+  size_t (*filter)(Pair *p, size_t n, Resistance R);
+} Kernels;
+
+/* ------------------------------------------------------------------------ */
+/* VARIABLES								    */
+/* ------------------------------------------------------------------------ */
+
+/* The implementation in use; the portable one until kernels_init. */
+extern const Kernels *kernels;
+
+/* ------------------------------------------------------------------------ */
+/* FUNCTION PROTOTYPES							    */
+/* ------------------------------------------------------------------------ */
+
+/* Returns the implementation called name ("scalar", "avx2" or "avx512")
+   when the processor supports it, else NULL.
+*/
+const Kernels *kernels_find(const char *name);
+
+/* Selects the implementation named by environment variable BUFFER_KERNELS
+   if set, else the AVX2 one if the processor supports it, else the
+   scalar one. Only the first call has any effect; calls from different
+   threads may overlap, and all return once the selection is made.
+*/
+void kernels_init(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* KERNELS_H */
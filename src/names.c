@@ -0,0 +1,198 @@
+/* Copyright (c) ACM/SIGDA
+   Prepared by Geert Janssen, geert@us.ibm.com
+*/
+
+/* ------------------------------------------------------------------------ */
+/* INCLUDES                                                                 */
+/* ------------------------------------------------------------------------ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "names.h"
+
+/* ------------------------------------------------------------------------ */
+/* LOCAL DEFINES                                                            */
+/* ------------------------------------------------------------------------ */
+
+/* Initial sizes of the name buffer and of the hash table: */
+#define NAMES_INIT_CAP	4096
+#define NAMES_INIT_HASH	1024
+
+/* ------------------------------------------------------------------------ */
+/* FUNCTION DEFINITIONS                                                     */
+/* ------------------------------------------------------------------------ */
+
+static void *
+names_realloc(void *p, size_t size)
+{
+  if (!(p = realloc(p, size))) {
+    printf("[names]: memory allocation failed.\n");
+    exit(1);
+  }
+  return p;
+}
+
+/* FNV-1a hash of string s. */
+static uint32_t
+str_hash(const char *s)
+{
+  uint32_t h = 2166136261u;
+
+  while (*s)
+    h = (h ^ (unsigned char) *s++) * 16777619u;
+  return h;
+}
+
+/* Returns the slot of the hash table of nt for name s with hash h: the
+   one holding it, or else the free one where it goes. Names are only
+   compared when their hashes are equal.
+*/
+static uint32_t
+names_slot(const Names *nt, const char *s, uint32_t h)
+{
+  uint32_t i = h & (nt->hashcap - 1);
+
+  for (; nt->hash[i].ref; i = (i + 1) & (nt->hashcap - 1))
+    if (nt->hash[i].hash == h && !strcmp(nt->text + nt->hash[i].ref - 1, s))
+      break;
+  return i;
+}
+
+/* Builds the hash table of a deduplicating table nt that has none (any
+   more) from its names, at most half full.
+*/
+static void
+names_build(Names *nt)
+{
+  uint32_t cap = NAMES_INIT_HASH;
+  size_t off;
+
+  while (cap < 2 * (nt->count + 1))
+    cap *= 2;
+  nt->hash = names_realloc(NULL, cap * sizeof(*nt->hash));
+  memset(nt->hash, 0, cap * sizeof(*nt->hash));
+  nt->hashcap = cap;
+  for (off = 0; off < nt->size; off += strlen(nt->text + off) + 1) {
+    uint32_t h = str_hash(nt->text + off);
+    uint32_t i = names_slot(nt, nt->text + off, h);
+
+    nt->hash[i].ref = off + 1;
+    nt->hash[i].hash = h;
+  }
+}
+
+/* Doubles the hash table of nt; the hashes are kept, so that no names
+   are read.
+*/
+static void
+names_grow(Names *nt)
+{
+  NameSlot *old = nt->hash;
+  uint32_t j, cap = nt->hashcap;
+
+  nt->hashcap *= 2;
+  nt->hash = names_realloc(NULL, nt->hashcap * sizeof(*nt->hash));
+  memset(nt->hash, 0, nt->hashcap * sizeof(*nt->hash));
+  for (j = 0; j < cap; j++)
+    if (old[j].ref) {
+      uint32_t i = old[j].hash & (nt->hashcap - 1);
+
+      while (nt->hash[i].ref)
+	i = (i + 1) & (nt->hashcap - 1);
+      nt->hash[i] = old[j];
+    }
+  free(old);
+}
+
+Names *
+names_mk(int dedup)
+{
+  Names *nt = names_realloc(NULL, sizeof(*nt));
+
+  memset(nt, 0, sizeof(*nt));
+  nt->dedup = dedup;
+  return nt;
+}
+
+Names *
+names_wrap(const char *text, size_t size)
+{
+  Names *nt = names_mk(0);
+
+  nt->text = (char *) text;
+  nt->size = nt->cap = size;
+  nt->wrapped = 1;
+  return nt;
+}
+
+uint32_t
+names_intern(Names *nt, const char *s)
+{
+  size_t len;
+  uint32_t h = 0, i = 0, off;
+
+  if (nt->wrapped) {
+    if (s < nt->text || s >= nt->text + nt->size) {
+      printf("[names_intern]: name not in wrapped table.\n");
+      exit(1);
+    }
+    if ((size_t) (s - nt->text) >= NAMES_NONE) {
+      printf("[names_intern]: text too large for 32-bit handles.\n");
+      exit(1);
+    }
+    return s - nt->text;
+  }
+  if (nt->dedup) {
+    if (!nt->hash)
+      names_build(nt);
+    h = str_hash(s);
+    if (nt->hash[i = names_slot(nt, s, h)].ref)
+      return nt->hash[i].ref - 1;
+  }
+
+  len = strlen(s) + 1;
+  /* Handles, plus one in the hash table, are 32 bits: */
+  if (nt->size + len >= NAMES_NONE) {
+    printf("[names_intern]: too many names.\n");
+    exit(1);
+  }
+  if (nt->size + len > nt->cap) {
+    do
+      nt->cap = nt->cap ? 2 * nt->cap : NAMES_INIT_CAP;
+    while (nt->size + len > nt->cap);
+    nt->text = names_realloc(nt->text, nt->cap);
+  }
+  off = nt->size;
+  memcpy(nt->text + off, s, len);
+  nt->size += len;
+  nt->count++;
+  if (nt->dedup) {
+    nt->hash[i].ref = off + 1;
+    nt->hash[i].hash = h;
+    if (2 * nt->count > nt->hashcap)
+      names_grow(nt);
+  }
+  return off;
+}
+
+void
+names_seal(Names *nt)
+{
+  free(nt->hash);
+  nt->hash = NULL;
+  nt->hashcap = 0;
+  if (!nt->wrapped && nt->size && nt->size < nt->cap) {
+    nt->text = names_realloc(nt->text, nt->size);
+    nt->cap = nt->size;
+  }
+}
+
+void
+names_free(Names *nt)
+{
+  if (!nt->wrapped)
+    free(nt->text);
+  free(nt->hash);
+  free(nt);
+}
@@ -0,0 +1,91 @@
+/* Copyright (c) ACM/SIGDA
+   Prepared by Geert Janssen, geert@us.ibm.com
+*/
+
+#ifndef NAMES_H
+#define NAMES_H
+
+/* ------------------------------------------------------------------------ */
+/* INCLUDES								    */
+/* ------------------------------------------------------------------------ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+/* ------------------------------------------------------------------------ */
+/* DEFINES								    */
+/* ------------------------------------------------------------------------ */
+
+/* Handles are below this: */
+#define NAMES_NONE		UINT32_MAX
+
+/* The name with handle h in table nt: */
+#define NAMES_STR(nt,h)		((const char *) (nt)->text + (h))
+
+/* ------------------------------------------------------------------------ */
+/* TYPE DEFINITIONS							    */
+/* ------------------------------------------------------------------------ */
+
+/* A table of names:
+   names are stored '\0'-terminated in one contiguous buffer, and are known
+   by their offset there, a 32-bit handle. A table either has a buffer of
+   its own, or wraps text that holds the names already, such as the input
+   text they were read from; either way, it is freed at once. A table of
+   its own can deduplicate, storing every distinct name once, at the cost
+   of a hash table. Handles stay valid as names are added, but the buffer
+   may move, so that a name string is only valid until the next name is
+   added.
+*/
+typedef struct NameSlot_S {
+  uint32_t ref;			/* 1 + handle, or 0 if free */
+  uint32_t hash;		/* of the name */
+} NameSlot;
+
+typedef struct Names_S Names;
+struct Names_S {
+  char *text;			/* the names, one after the other */
+  size_t size, cap;		/* bytes used and allocated */
+  int wrapped;			/* text is not owned, see names_wrap */
+  int dedup;			/* each distinct name is stored once */
+  NameSlot *hash;		/* if dedup; NULL until a name is added */
+  uint32_t hashcap;		/* power of 2 */
+  uint32_t count;		/* number of names in hash */
+};
+
+/* ------------------------------------------------------------------------ */
+/* FUNCTION PROTOTYPES							    */
+/* ------------------------------------------------------------------------ */
+
+/* Returns a new, empty table, which deduplicates when dedup is set. */
+Names *names_mk(int dedup);
+
+/* Returns a table of the '\0'-terminated names in the size bytes at
+   text, used in place: text must stay available and unmodified as long as
+   the table is in use. Only names that are in text already can be added.
+*/
+Names *names_wrap(const char *text, size_t size);
+
+/* Returns the handle of name s in table nt. For a wrapped table, s must
+   be in its text, and is taken in place. Else s is copied into the table,
+   unless it deduplicates and has s already.
+*/
+uint32_t names_intern(Names *nt, const char *s);
+
+/* Releases the memory that table nt only needs for adding names: its
+   hash table, rebuilt when a name is added again, and unused buffer
+   space. Handles stay valid.
+*/
+void names_seal(Names *nt);
+
+/* Frees table nt, with all its names. */
+void names_free(Names *nt);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* NAMES_H */
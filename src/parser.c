@@ -6,20 +6,55 @@
 /* INCLUDES                                                                 */
 /* ------------------------------------------------------------------------ */
 
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include "parser.h"
+#include "bintree.h"
 
 /* ------------------------------------------------------------------------ */
 /* LOCAL DEFINES                                                            */
 /* ------------------------------------------------------------------------ */
 
+/* Size of the first block read from a non-seekable input: */
+#define READ_BLOCK	(1 << 20)
+/* Size of the window on a streamed input, and the longest token in it: */
+#define STREAM_BLOCK	(1 << 16)
+#define TOKEN_MAX	4096
+
+/* Largest mantissa and power of ten for which the fast path of
+   read_number is exact (Clinger):
+*/
+#define FAST_MANT	(1ULL << 53)
+#define FAST_EXP	22
+
+#define IS_SPACE(c)	isspace((unsigned char) (c))
+#define IS_DIGIT(c)	((unsigned) ((c) - '0') < 10)
+
 /* ------------------------------------------------------------------------ */
 /* LOCAL TYPE DEFINITIONS                                                   */
 /* ------------------------------------------------------------------------ */
 
+/* An internal node whose closing ')' has not been seen yet. */
+typedef struct Frame_S {
+  const char *id;		/* identification string */
+  size_t off;			/* if streamed, offset of its copy */
+  double wire;			/* length of wire to parent node */
+  uint32_t nsub;		/* number of subtrees parsed */
+} Frame;
+
 /* ------------------------------------------------------------------------ */
 /* LOCAL VARIABLES                                                          */
 /* ------------------------------------------------------------------------ */
 
+/* Exact powers of ten for the fast path of read_number: */
+static const double pow10[FAST_EXP + 1] = {
+  1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
 /* ------------------------------------------------------------------------ */
 /* FUNCTION DEFINITIONS                                                     */
 /* ------------------------------------------------------------------------ */
@@ -49,48 +84,201 @@ fatal(char *mes, ...)
 /* The Lexer                                                             */
 /* --------------------------------------------------------------------- */
 
-/* Reads a character (first skips any white-space). */
+/* Makes the complete input from file descriptor fd available in in.
+   A regular file is mapped into memory (privately, so that tokens can be
+   terminated in place); the bytes beyond end-of-file in its last page
+   read as 0. Any other input, or a file that exactly fills its last page,
+   is read in large blocks.
+*/
+static void
+load_input(Input *in, int fd)
+{
+  struct stat st;
+  size_t size = 0, cap = READ_BLOCK;
+  ssize_t n;
+  char *text;
+
+  if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0
+      && st.st_size % sysconf(_SC_PAGESIZE)) {
+    text = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    if (text != MAP_FAILED) {
+      in->text = in->pos = text;
+      in->end = text + st.st_size;
+      in->mapped = st.st_size;
+      return;
+    }
+  }
+
+  text = malloc(cap + 1);
+  while (text && (n = read(fd, text + size, cap - size)) > 0)
+    if ((size += n) == cap)
+      text = realloc(text, (cap *= 2) + 1);
+  if (!text) {
+    printf("[load_input]: memory allocation failed.\n");
+    exit(1);
+  }
+  text[size] = '\0';
+  in->text = in->pos = text;
+  in->end = text + size;
+  in->mapped = 0;
+}
+
+/* Moves the unread text of streamed input in to the start of its window
+   and reads more input after it. Returns 0 when nothing was added.
+*/
 static int
-readc(void)
+input_more(Input *in)
 {
-  int c;
+  size_t left = in->end - in->pos;
+  char *end;
+  ssize_t n = 0;
+
+  if (in->fd < 0 || in->eof)
+    return 0;
+  memmove(in->text, in->pos, left);
+  in->pos = in->text;
+  end = in->end = in->text + left;
+  while (in->end < in->text + STREAM_BLOCK
+	 && (n = read(in->fd, in->end, in->text + STREAM_BLOCK - in->end)) > 0)
+    in->end += n;
+  if (n <= 0)
+    in->eof = 1;
+  *in->end = '\0';
+  return in->end > end;
+}
+
+/* Skips any white-space. A streamed input is refilled well before the
+   end of its window, so that the next token is completely in it.
+*/
+static void
+skip_space(Input *in)
+{
+  do
+    while (in->pos < in->end && IS_SPACE(*in->pos))
+      in->pos++;
+  while (in->end - in->pos < TOKEN_MAX && input_more(in));
+}
 
- restart:
-  /* Check for end-of-file condition: */
-  if (feof(stdin)) return EOF;
+/* Reads a character (first skips any white-space). */
+static int
+readc(Input *in)
+{
+  for (;;) {
+    skip_space(in);
 
-  /* Skip any whitespace: */
-  do c = getchar(); while (isspace(c));
+    /* Check for end-of-file condition: */
+    if (in->pos == in->end) return EOF;
 
-  /* Skip any comment-till-end-of-line: */
-  if (c == '#') {
-    while ((c = getchar()) != '\n' && c != EOF)
-      ;
-    goto restart;
+    /* Skip any comment-till-end-of-line: */
+    if (*in->pos != '#')
+      return *in->pos++;
+    do
+      while (in->pos < in->end && *in->pos != '\n')
+	in->pos++;
+    while (in->pos == in->end && input_more(in));
   }
-  return c;
 }
 
-/* Reads an identifier (first skips any white-space). */
+/* Pushes back character c just read by readc. */
+static void
+unreadc(Input *in, int c)
+{
+  if (c != EOF)
+    in->pos--;
+}
+
+/* Reads an identifier (first skips any white-space).
+   The identifier is terminated in place in the input text, which is why
+   it consumes the white-space character that follows it. For a streamed
+   input, it is only valid until the next token is read.
+*/
 static const char *
-read_ident(void)
+read_ident(Input *in)
 {
-  char s[BUFSIZ];
+  char *s;
 
-  if (fscanf(stdin, "%s", s) != 1)
+  skip_space(in);
+  if (in->pos == in->end)
     fatal("identifier expected");
-  return (const char *) strcpy(malloc(strlen(s) + 1), s);
+  for (s = in->pos; in->pos < in->end && !IS_SPACE(*in->pos); in->pos++)
+    ;
+  if (in->fd >= 0 && in->pos - s >= TOKEN_MAX)
+    fatal("identifier longer than %d characters", TOKEN_MAX - 1);
+  if (in->pos < in->end)
+    *in->pos++ = '\0';
+  return s;
 }
 
-/* Reads a C-style floating point number (first skips any white-space). */
+/* Reads a C-style floating point number (first skips any white-space).
+   Plain decimal numbers with at most 19 significant digits and a small
+   exponent are converted exactly by a single multiplication or division
+   by a power of ten; anything else is left to strtod.
+*/
 static double
-read_number(void)
+read_number(Input *in)
 {
-  double n;
+  char *s, *p;
+  unsigned long long m = 0;
+  int nd = 0, sig = 0, exp = 0;
+  int slow = 0, neg;
+
+  skip_space(in);
+  s = p = in->pos;
+  if ((neg = *p == '-') || *p == '+')
+    p++;
+
+  /* Mantissa: */
+  for (; IS_DIGIT(*p); p++, nd++)
+    if (sig < 19) {
+      if ((m = 10 * m + (*p - '0')))
+	sig++;
+    }
+    else
+      slow = 1;
+  if (*p == '.') {
+    for (p++; IS_DIGIT(*p); p++, nd++)
+      if (sig < 19) {
+	if ((m = 10 * m + (*p - '0')))
+	  sig++;
+	exp--;
+      }
+      else
+	slow = 1;
+  }
+  /* No digits at all (inf, nan) or a hexadecimal number: */
+  if (!nd || *p == 'x' || *p == 'X')
+    slow = 1;
+
+  /* Exponent; the 'e' is not part of the number when no digits follow: */
+  if (!slow && (*p == 'e' || *p == 'E')) {
+    char *q = p + 1;
+    int eneg, e = 0;
+
+    if ((eneg = *q == '-') || *q == '+')
+      q++;
+    if (IS_DIGIT(*q)) {
+      for (; IS_DIGIT(*q); q++)
+	if (e < 10000)
+	  e = 10 * e + (*q - '0');
+      exp += eneg ? -e : e;
+      p = q;
+    }
+  }
+
+  if (!slow && m <= FAST_MANT && exp >= -FAST_EXP && exp <= FAST_EXP) {
+    double n = exp < 0 ? m / pow10[-exp] : m * pow10[exp];
+
+    in->pos = p;
+    return neg ? -n : n;
+  }
+  else {
+    double n = strtod(s, &p);
 
-  if (fscanf(stdin, "%lf", &n) != 1)
-    fatal("floating-point number expected");
-  return n;
+    if (p == s)
+      fatal("floating-point number expected");
+    in->pos = p;
+    return n;
+  }
 }
 
 /* --------------------------------------------------------------------- */
@@ -98,58 +286,292 @@ read_number(void)
 /* --------------------------------------------------------------------- */
 
 /* Leaf : "<" Id Wire_Length Required_Time Load ">" . */
-static Tree
-P_Leaf(void)
+static void
+P_Leaf(Input *in, const Builder *b)
 {
   int c;
   const char *id;
+  char copy[TOKEN_MAX];
   double wl, rt, cl;
 
-  if ((c = readc()) != '<')
+  if ((c = readc(in)) != '<')
     fatal("'<' expected");
 
-  id = read_ident();
-  wl = read_number();
-  rt = read_number();
-  cl = read_number();
+  id = read_ident(in);
+  if (in->fd >= 0)
+    id = strcpy(copy, id);
+  wl = read_number(in);
+  rt = read_number(in);
+  cl = read_number(in);
 
-  if ((c = readc()) != '>')
+  if ((c = readc(in)) != '>')
     fatal("'>' expected");
 
-  return tree_mk_leaf(id, wl, rt, cl);
+  b->leaf(b->arg, id, wl, rt, cl);
 }
 
 /* Tree          : Leaf
-                 | "(" Id Wire_Length Tree Tree ")" .
+                 | "(" Id Wire_Length Tree+ ")" .
+
+   The nesting of internal nodes is kept on an explicit stack rather than
+   in recursive calls, so that the depth of the tree is only limited by
+   the available heap. Nodes are passed to builder b as they are
+   completed, which is in post-order. Names of a streamed input are copied
+   onto a stack of characters alongside, as they are used in the same
+   order.
 */
-static Tree
-P_Tree(void)
+static void
+P_Tree(Input *in, const Builder *b)
 {
-  Tree t1, t2;
+  Frame *stack = NULL;
+  char *names = NULL;
+  size_t nsize = 0, ncap = 0;
+  int size = 0, top = 0;
   int c;
-  const char *id;
-  double wl;
 
-  if ((c = readc()) != '(') {
-    ungetc(c, stdin);
-    return P_Leaf();
+  for (;;) {
+    /* Open internal nodes till reaching a leaf: */
+    while ((c = readc(in)) == '(') {
+      if (top == size) {
+	size = size ? 2 * size : 64;
+	stack = realloc(stack, size * sizeof(*stack));
+	if (!stack) {
+	  printf("[P_Tree]: memory allocation failed.\n");
+	  exit(1);
+	}
+      }
+      stack[top].id   = read_ident(in);
+      if (in->fd >= 0) {
+	size_t len = strlen(stack[top].id) + 1;
+
+	if (nsize + len > ncap) {
+	  ncap = ncap ? 2 * ncap : 2 * TOKEN_MAX;
+	  if (!(names = realloc(names, ncap))) {
+	    printf("[P_Tree]: memory allocation failed.\n");
+	    exit(1);
+	  }
+	}
+	memcpy(names + nsize, stack[top].id, len);
+	stack[top].off = nsize;
+	nsize += len;
+      }
+      stack[top].wire = read_number(in);
+      stack[top].nsub = 0;
+      top++;
+    }
+    unreadc(in, c);
+    P_Leaf(in, b);
+
+    /* Each completed subtree is counted by its parent, which is itself
+       completed when a ')' follows; else another subtree follows:
+    */
+    while (top) {
+      Frame *k = &stack[top-1];
+
+      k->nsub++;
+      if ((c = readc(in)) != ')') {
+	unreadc(in, c);
+	break;
+      }
+      if (in->fd >= 0) {
+	b->inode(b->arg, names + k->off, k->wire, k->nsub);
+	nsize = k->off;
+      }
+      else
+	b->inode(b->arg, k->id, k->wire, k->nsub);
+      top--;
+    }
+    if (!top)
+      break;
+  }
+  free(stack);
+  free(names);
+}
+
+Input *
+input_open(const char *fname)
+{
+  Input *in;
+  int fd = 0;
+
+  if (fname && (fd = open(fname, O_RDONLY)) < 0)
+    return NULL;
+  if (!(in = malloc(sizeof(*in)))) {
+    printf("[input_open]: memory allocation failed.\n");
+    exit(1);
+  }
+  load_input(in, fd);
+  if (fname)
+    close(fd);
+  in->fd = -1;
+  in->inplace = 0;
+  return in;
+}
+
+Input *
+input_stream(const char *fname)
+{
+  Input *in;
+  int fd = 0;
+
+  if (fname && (fd = open(fname, O_RDONLY)) < 0)
+    return NULL;
+  if (!(in = malloc(sizeof(*in))) || !(in->text = malloc(STREAM_BLOCK + 1))) {
+    printf("[input_stream]: memory allocation failed.\n");
+    exit(1);
   }
+  in->pos = in->end = in->text;
+  in->mapped = 0;
+  in->fd = fd;
+  in->eof = 0;
+  in->inplace = 0;
+  input_more(in);
+  return in;
+}
+
+void
+input_close(Input *in)
+{
+  if (in->fd > 0)
+    close(in->fd);
+  if (in->mapped)
+    munmap(in->text, in->mapped);
+  else
+    free(in->text);
+  free(in);
+}
 
-  id = read_ident();
-  wl = read_number();
+static void
+build_leaf(void *f, const char *id, double wire, double time, double load)
+{
+  ftree_add_leaf(f, id, wire, time, load);
+}
 
-  t1 = P_Tree();
-  t2 = P_Tree();
+static void
+build_inode(void *f, const char *id, double wire, uint32_t nsub)
+{
+  ftree_add_inode(f, id, wire, nsub);
+}
 
-  if (readc() != ')')
-    fatal("')' expected");
+int
+parse_build(Input *in, const Builder *b)
+{
+  int c;
 
-  return tree_mk_inode(id, wl, t1, t2);
+  if (in->fd >= 0 && in->pos == in->text
+      && bintree_is(in->text, in->end - in->text)) {
+    fprintf(stderr, "Binary trees cannot be streamed.\n");
+    exit(1);
+  }
+  if ((c = readc(in)) == EOF)
+    return 0;
+  unreadc(in, c);
+  P_Tree(in, b);
+  return 1;
 }
 
 /* Input : Tree */
+FTree
+parse_next(Input *in)
+{
+  Builder b;
+  FTree f;
+
+  if (in->pos == in->text && bintree_is(in->text, in->end - in->text)) {
+    in->pos = in->end;
+    return bintree_decode(in->text, in->end - in->text);
+  }
+  /* Handles into the text are offsets, which must fit in 32 bits: */
+  if (in->inplace && (size_t) (in->end - in->text) < NAMES_NONE)
+    f = ftree_mk_names(names_wrap(in->text, in->end - in->text));
+  else
+    f = ftree_mk_names(names_mk(1));
+  b.leaf = build_leaf;
+  b.inode = build_inode;
+  b.arg = f;
+  if (!parse_build(in, &b)) {
+    ftree_free(f);
+    return NULL;
+  }
+  /* No more names are added: */
+  names_seal(f->names);
+  return f;
+}
+
+Buffer *
+parse_library(Input *in, int *n)
+{
+  Buffer *lib = NULL;
+  int c, size = 0;
+
+  for (*n = 0; (c = readc(in)) != EOF; ++*n) {
+    unreadc(in, c);
+    if (*n == size) {
+      size = size ? 2 * size : 16;
+      if (!(lib = realloc(lib, size * sizeof(*lib)))) {
+	printf("[parse_library]: memory allocation failed.\n");
+	exit(1);
+      }
+    }
+    lib[*n].id = read_ident(in);
+    lib[*n].R  = read_number(in);
+    lib[*n].C  = read_number(in);
+    lib[*n].D  = read_number(in);
+    lib[*n].inverts = lib[*n].id[0] == '~';
+  }
+  return lib;
+}
+
+int
+parse_edit(Input *in, Edit *ed)
+{
+  const char *kind;
+  int c;
+
+  if ((c = readc(in)) == EOF)
+    return 0;
+  unreadc(in, c);
+  kind = read_ident(in);
+  if (!strcmp(kind, "sink"))
+    ed->sink = 1;
+  else if (!strcmp(kind, "wire"))
+    ed->sink = 0;
+  else
+    fatal("`sink' or `wire' expected");
+  ed->id = read_ident(in);
+  if (ed->sink) {
+    ed->time = read_number(in);
+    ed->load = read_number(in);
+  }
+  else
+    ed->wire = read_number(in);
+  return 1;
+}
+
+FTree
+parse_flat(int inplace)
+{
+  Input *in = input_open(NULL);
+  FTree f;
+
+  in->inplace = inplace;
+  if (!(f = parse_next(in)))
+    fatal("tree expected");
+  /* Only a text tree with names of its own can do without the input: */
+  if (f->cap && !f->names->wrapped)
+    input_close(in);
+  return f;
+}
+
 Tree
-parse(void)
+parse(Names **names)
 {
-  return P_Tree();
+  FTree f = parse_flat(0);
+  Tree t = ftree_tree(f);
+
+  /* The names go with the tree: */
+  *names = f->names;
+  f->shared = 1;
+  ftree_free(f);
+  return t;
 }
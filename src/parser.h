@@ -6,6 +6,7 @@
 #define PARSER_H
 
 #include "tree.h"
+#include "engine.h"
 
 #if defined __cplusplus
 extern "C" {
@@ -19,7 +20,7 @@ extern "C" {
 
         Input         : Tree .
         Tree          : Leaf
-                      | "(" Id Wire_Length Tree Tree ")" .
+                      | "(" Id Wire_Length Tree+ ")" .
         Leaf          : "<" Id Wire_Length Required_Time Load ">" .
         Wired_Length  : Float_Number .
         Required_Time : Float_Number .
@@ -31,16 +32,124 @@ extern "C" {
 	 blank character or end-of-file.
 */
 
+/* An input text from which trees are parsed. */
+typedef struct Input_S Input;
+struct Input_S {
+  char *text;			/* complete text, writable, *end == '\0' */
+  char *end;
+  char *pos;			/* current read position */
+  size_t mapped;		/* length of memory mapping, 0 if malloc'd */
+  int fd;			/* streamed: text is a window on it; else -1 */
+  int eof;			/* streamed and all read */
+  int inplace;			/* parse_next: take names from the text */
+};
+
+/* What to do with the nodes of a tree while it is parsed. The nodes are
+   passed in post-order; an internal node has as subtrees the nsub ones
+   most recently completed. Node names are only valid during the call
+   when the input is streamed.
+*/
+typedef struct Builder_S {
+  void (*leaf)(void *arg, const char *id, double wire, double time,
+	       double load);
+  void (*inode)(void *arg, const char *id, double wire, uint32_t nsub);
+  void *arg;
+} Builder;
+
 /* Reads a fanout tree from stdin and constructs a tree data structure
    using the functions and macros defined in the file `tree.h'.
    The accepted input format is defined above.
    Aborts (with exit(1)) whenever a syntax error occurs.
+   Input in the binary format of `bintree.h' is recognized and accepted
+   as well.
+   The input is read (or mapped) into memory as a whole. The node names
+   are interned in a table of names, see `names.h', returned in *names;
+   the text itself is released after parsing.
 
    The top-level production rule is:
 
         Input : Tree .
 */
-Tree parse(void);
+Tree parse(Names **names);
+
+/* As parse, but returns the flat representation of the tree, with its
+   names taken in place as for parse_next when inplace is set; the input
+   is then kept. When the input is in binary format, its node arrays and
+   string table are used in place, and it is kept as well.
+*/
+FTree parse_flat(int inplace);
+
+/* Returns the input read from file fname, or from stdin when fname is
+   NULL. Returns NULL when the file cannot be opened.
+   Inputs are independent, so different threads may parse different
+   inputs at the same time.
+*/
+Input *input_open(const char *fname);
+
+/* As input_open, but the text is read in a small window that moves along
+   with parsing, so that memory use does not depend on the size of the
+   input. Identifiers can then be at most 4095 characters long. Such an
+   input can only be parsed with parse_build, and not in binary format.
+*/
+Input *input_stream(const char *fname);
+
+/* Parses the next tree from input in, passing its nodes to builder b.
+   Returns 0 at end of input. Syntax as for parse_next.
+*/
+int parse_build(Input *in, const Builder *b);
+
+/* Returns the flat representation of the next tree from input in, or
+   NULL at end of input. A text input may contain any number of trees one
+   after another:
+
+        Batch_Input   : Tree* .
+
+   A text tree has its node names interned in a table of its own, which
+   stores each distinct name once, so that it can outlive in. When the
+   inplace field of in is set, the names are instead taken in place from
+   the input text, which saves copying them, but then the trees can only
+   be used until in is closed; a text of 4 GB or more is interned all the
+   same, as handles are 32 bits. A binary tree always uses the input text
+   in place.
+*/
+FTree parse_next(Input *in);
+
+/* Returns the buffer library read from input in, and its size in *n.
+   Syntax, with comments and white-space as for trees:
+
+        Library       : Buffer* .
+        Buffer        : Id Resistance Capacitance Delay .
+        Resistance    : Float_Number .
+        Capacitance   : Float_Number .
+        Delay         : Float_Number .
+
+   A type whose name starts with a '~' is an inverter. Buffer names point
+   into the input text.
+*/
+Buffer *parse_library(Input *in, int *n);
+
+/* A change to a tree node. */
+typedef struct Edit_S {
+  const char *id;		/* node name */
+  int sink;			/* sets time and load, else wire */
+  double wire;
+  double time;
+  double load;
+} Edit;
+
+/* Reads the next edit from input in into *ed; returns 0 at end of input.
+   Syntax, with comments and white-space as for trees:
+
+        Edits         : Edit* .
+        Edit          : "wire" Id Length
+                      | "sink" Id Time Load .
+
+   Node names point into the input text.
+*/
+int parse_edit(Input *in, Edit *ed);
+
+/* Releases input in. */
+void input_close(Input *in);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,270 @@
+/* Copyright (c) 2003 ACM/SIGDA
+   Prepared by Geert Janssen, geert@us.ibm.com
+*/
+
+/* ------------------------------------------------------------------------ */
+/* INCLUDES                                                                 */
+/* ------------------------------------------------------------------------ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+#include "pool.h"
+
+/* ------------------------------------------------------------------------ */
+/* LOCAL DEFINES                                                            */
+/* ------------------------------------------------------------------------ */
+
+/* Initial capacity of a worker's task queue: */
+#define DEQUE_INIT_CAP	64
+
+/* ------------------------------------------------------------------------ */
+/* LOCAL TYPE DEFINITIONS                                                   */
+/* ------------------------------------------------------------------------ */
+
+/* A worker's double-ended task queue: a circular buffer. */
+typedef struct Deque_S {
+  pthread_mutex_t lock;
+  Task **tasks;
+  unsigned cap;			/* power of 2 */
+  unsigned head;		/* index of oldest task */
+  unsigned len;			/* number of tasks */
+} Deque;
+
+typedef struct Worker_S {
+  Pool *pool;
+  int id;
+  unsigned seed;		/* for picking a victim to steal from */
+  pthread_t thread;
+  Deque deque;
+} Worker;
+
+struct Pool_S {
+  int size;			/* number of workers */
+  Worker *workers;
+  pthread_mutex_t lock;		/* protects the following: */
+  pthread_cond_t wakeup;	/* signalled when tasks appear */
+  unsigned pending;		/* tasks in all queues */
+  int shutdown;			/* stop the workers */
+};
+
+/* ------------------------------------------------------------------------ */
+/* LOCAL VARIABLES                                                          */
+/* ------------------------------------------------------------------------ */
+
+/* The worker (of any pool) that is the calling thread: */
+static _Thread_local Worker *self;
+
+/* ------------------------------------------------------------------------ */
+/* FUNCTION DEFINITIONS                                                     */
+/* ------------------------------------------------------------------------ */
+
+static void
+deque_init(Deque *d)
+{
+  pthread_mutex_init(&d->lock, NULL);
+  d->tasks = NULL;
+  d->cap = d->head = d->len = 0;
+}
+
+static void
+deque_push_back(Deque *d, Task *t)
+{
+  pthread_mutex_lock(&d->lock);
+  if (d->len == d->cap) {
+    unsigned i, cap = d->cap ? 2 * d->cap : DEQUE_INIT_CAP;
+    Task **tasks = malloc(cap * sizeof(*tasks));
+
+    if (!tasks) {
+      printf("[pool_spawn]: memory allocation failed.\n");
+      exit(1);
+    }
+    for (i = 0; i < d->len; i++)
+      tasks[i] = d->tasks[(d->head + i) & (d->cap - 1)];
+    free(d->tasks);
+    d->tasks = tasks;
+    d->cap = cap;
+    d->head = 0;
+  }
+  d->tasks[(d->head + d->len++) & (d->cap - 1)] = t;
+  pthread_mutex_unlock(&d->lock);
+}
+
+static Task *
+deque_pop_back(Deque *d)
+{
+  Task *t = NULL;
+
+  pthread_mutex_lock(&d->lock);
+  if (d->len)
+    t = d->tasks[(d->head + --d->len) & (d->cap - 1)];
+  pthread_mutex_unlock(&d->lock);
+  return t;
+}
+
+static Task *
+deque_pop_front(Deque *d)
+{
+  Task *t = NULL;
+
+  pthread_mutex_lock(&d->lock);
+  if (d->len) {
+    t = d->tasks[d->head];
+    d->head = (d->head + 1) & (d->cap - 1);
+    d->len--;
+  }
+  pthread_mutex_unlock(&d->lock);
+  return t;
+}
+
+/* Returns a task for worker w from its own queue, or stolen from another
+   worker's, or NULL if none is available.
+*/
+static Task *
+take(Worker *w)
+{
+  Pool *p = w->pool;
+  Task *t;
+  int i, v;
+
+  if (!(t = deque_pop_back(&w->deque)) && p->size > 1) {
+    w->seed = w->seed * 1103515245 + 12345;
+    v = (w->seed >> 16) % p->size;
+    for (i = 0; i < p->size && !t; i++, v = (v + 1) % p->size)
+      if (v != w->id)
+	t = deque_pop_front(&p->workers[v].deque);
+  }
+  if (t) {
+    pthread_mutex_lock(&p->lock);
+    p->pending--;
+    pthread_mutex_unlock(&p->lock);
+  }
+  return t;
+}
+
+static void
+execute(Task *t)
+{
+  t->fn(t);
+  __atomic_store_n(&t->done, 1, __ATOMIC_RELEASE);
+}
+
+static void *
+worker_main(void *arg)
+{
+  Worker *w = self = arg;
+  Pool *p = w->pool;
+
+  for (;;) {
+    Task *t = take(w);
+
+    if (t) {
+      execute(t);
+      continue;
+    }
+    pthread_mutex_lock(&p->lock);
+    while (!p->pending && !p->shutdown)
+      pthread_cond_wait(&p->wakeup, &p->lock);
+    if (p->shutdown) {
+      pthread_mutex_unlock(&p->lock);
+      return NULL;
+    }
+    pthread_mutex_unlock(&p->lock);
+  }
+}
+
+Pool *
+pool_mk(int threads)
+{
+  Pool *p = malloc(sizeof(*p));
+  int i;
+
+  if (threads < 1)
+    threads = 1;
+  if (!p || !(p->workers = malloc(threads * sizeof(*p->workers)))) {
+    printf("[pool_mk]: memory allocation failed.\n");
+    exit(1);
+  }
+  p->size = threads;
+  pthread_mutex_init(&p->lock, NULL);
+  pthread_cond_init(&p->wakeup, NULL);
+  p->pending = 0;
+  p->shutdown = 0;
+
+  for (i = 0; i < threads; i++) {
+    Worker *w = &p->workers[i];
+
+    w->pool = p;
+    w->id = i;
+    w->seed = i + 1;
+    deque_init(&w->deque);
+  }
+  self = &p->workers[0];
+  for (i = 1; i < threads; i++)
+    if (pthread_create(&p->workers[i].thread, NULL, worker_main,
+		       &p->workers[i])) {
+      printf("[pool_mk]: cannot create thread.\n");
+      exit(1);
+    }
+  return p;
+}
+
+int
+pool_size(Pool *p)
+{
+  return p->size;
+}
+
+int
+pool_worker(Pool *p)
+{
+  return self->id;
+}
+
+void
+pool_spawn(Pool *p, Task *t, void (*fn)(Task *t))
+{
+  t->fn = fn;
+  t->done = 0;
+  /* Count first, so that pending never drops below the actual number: */
+  pthread_mutex_lock(&p->lock);
+  p->pending++;
+  pthread_cond_signal(&p->wakeup);
+  pthread_mutex_unlock(&p->lock);
+  deque_push_back(&self->deque, t);
+}
+
+void
+pool_wait(Pool *p, Task *t)
+{
+  while (!__atomic_load_n(&t->done, __ATOMIC_ACQUIRE)) {
+    Task *o = take(self);
+
+    if (o)
+      execute(o);
+    else
+      sched_yield();
+  }
+}
+
+void
+pool_free(Pool *p)
+{
+  int i;
+
+  pthread_mutex_lock(&p->lock);
+  p->shutdown = 1;
+  pthread_cond_broadcast(&p->wakeup);
+  pthread_mutex_unlock(&p->lock);
+  for (i = 1; i < p->size; i++)
+    pthread_join(p->workers[i].thread, NULL);
+  for (i = 0; i < p->size; i++) {
+    pthread_mutex_destroy(&p->workers[i].deque.lock);
+    free(p->workers[i].deque.tasks);
+  }
+  pthread_mutex_destroy(&p->lock);
+  pthread_cond_destroy(&p->wakeup);
+  free(p->workers);
+  free(p);
+}
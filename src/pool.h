@@ -0,0 +1,66 @@
+/* Copyright (c) 2003 ACM/SIGDA
+   Prepared by Geert Janssen, geert@us.ibm.com
+*/
+
+#ifndef POOL_H
+#define POOL_H
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+/* ------------------------------------------------------------------------ */
+/* TYPE DEFINITIONS							    */
+/* ------------------------------------------------------------------------ */
+
+/* A unit of work: fn(task) is called once by some worker thread.
+   Embed a Task as first member of a larger struct to pass arguments.
+*/
+typedef struct Task_S Task;
+struct Task_S {
+  void (*fn)(Task *t);		/* the work */
+  volatile int done;		/* set once fn has returned */
+};
+
+/* A fixed set of worker threads with work stealing:
+   every worker has its own double-ended queue of tasks. It pushes and pops
+   at the back of its own queue (so its most recently spawned, smallest
+   tasks run first), and when that is empty it steals the oldest task from
+   the front of another worker's queue.
+   The thread that creates the pool is worker 0.
+*/
+typedef struct Pool_S Pool;
+
+/* ------------------------------------------------------------------------ */
+/* FUNCTION PROTOTYPES							    */
+/* ------------------------------------------------------------------------ */
+
+/* Returns a pool of `threads' workers, including the calling thread. */
+Pool *pool_mk(int threads);
+
+/* Returns the number of workers of pool p. */
+int pool_size(Pool *p);
+
+/* Returns the index of the calling worker thread of pool p. */
+int pool_worker(Pool *p);
+
+/* Makes task t available for execution by any worker.
+   May only be called from a worker thread of p.
+*/
+void pool_spawn(Pool *p, Task *t, void (*fn)(Task *t));
+
+/* Returns once task t is done, executing other tasks while waiting.
+   May only be called from a worker thread of p.
+*/
+void pool_wait(Pool *p, Task *t);
+
+/* Stops the worker threads and frees pool p. Must be called by the thread
+   that created the pool, with no tasks pending.
+*/
+void pool_free(Pool *p);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* POOL_H */
@@ -12,6 +12,9 @@
 /* LOCAL DEFINES                                                            */
 /* ------------------------------------------------------------------------ */
 
+/* Initial number of nodes allocated for a flat tree: */
+#define FTREE_INIT_CAP	1024
+
 /* ------------------------------------------------------------------------ */
 /* LOCAL TYPE DEFINITIONS                                                   */
 /* ------------------------------------------------------------------------ */
@@ -25,7 +28,7 @@
 /* ------------------------------------------------------------------------ */
 
 Tree
-tree_mk_leaf(const char *id, double wire, double time, double load)
+tree_mk_leaf(uint32_t id, double wire, double time, double load)
 {
   Tree t = malloc(sizeof(*t));
 
@@ -35,7 +38,7 @@ tree_mk_leaf(const char *id, double wire, double time, double load)
   }
 
   T_LEAF(t) = 1;
-  T_NAME(t) = id;
+  T_ID(t) = id;
   T_WIRE(t) = wire;
   T_TIME(t) = time;
   T_LOAD(t) = load;
@@ -45,9 +48,10 @@ tree_mk_leaf(const char *id, double wire, double time, double load)
 }
 
 Tree
-tree_mk_inode(const char *id, double wire, Tree sub1, Tree sub2)
+tree_mk_inode(uint32_t id, double wire, unsigned nsub, const Tree *sub)
 {
-  Tree t = malloc(sizeof(*t));
+  /* The array of subtrees follows the node in the same block: */
+  Tree t = malloc(sizeof(*t) + nsub * sizeof(*sub));
 
   if (!t) {
     printf("[tree_mk]: memory allocation failed.\n");
@@ -55,11 +59,218 @@ tree_mk_inode(const char *id, double wire, Tree sub1, Tree sub2)
   }
 
   T_LEAF(t) = 0;
-  T_NAME(t) = id;
+  T_ID(t) = id;
   T_WIRE(t) = wire;
-  T_SUB1(t) = sub1;
-  T_SUB2(t) = sub2;
+  T_NSUB(t) = nsub;
+  t->u.i.sub = (Tree *) (t + 1);
+  memcpy(t->u.i.sub, sub, nsub * sizeof(*sub));
   T_DATA(t) = NULL;
 
   return t;
 }
+
+void
+tree_postorder(Tree t, void (*visit)(Tree k, void *arg), void *arg)
+{
+  /* Internal nodes on the path to the root, and the subtree each is
+     working on:
+  */
+  struct { Tree k; unsigned sub; } *stack = NULL;
+  int size = 0, top = 0;
+
+  for (;;) {
+    /* Descend along first subtrees down to a leaf: */
+    while (!T_LEAF(t)) {
+      if (top == size) {
+	size = size ? 2 * size : 64;
+	stack = realloc(stack, size * sizeof(*stack));
+	if (!stack) {
+	  printf("[tree_postorder]: memory allocation failed.\n");
+	  exit(1);
+	}
+      }
+      stack[top].k = t;
+      stack[top].sub = 0;
+      top++;
+      t = T_SUB(t, 0);
+    }
+    visit(t, arg);
+
+    /* Ascend while coming back from a last subtree: */
+    while (top && stack[top-1].sub + 1 == T_NSUB(stack[top-1].k))
+      visit(stack[--top].k, arg);
+    if (!top)
+      break;
+    t = T_SUB(stack[top-1].k, ++stack[top-1].sub);
+  }
+  free(stack);
+}
+
+static void *
+ftree_realloc(void *p, size_t size)
+{
+  if (!(p = realloc(p, size))) {
+    printf("[ftree_mk]: memory allocation failed.\n");
+    exit(1);
+  }
+  return p;
+}
+
+FTree
+ftree_mk_names(Names *nt)
+{
+  FTree f = ftree_realloc(NULL, sizeof(*f));
+
+  memset(f, 0, sizeof(*f));
+  f->names = nt;
+  return f;
+}
+
+FTree
+ftree_mk(void)
+{
+  return ftree_mk_names(names_mk(0));
+}
+
+/* Makes room for one more node in flat tree f; returns its index. */
+static uint32_t
+ftree_add(FTree f, uint32_t id, double wire)
+{
+  uint32_t i = f->n++;
+
+  if (i == f->cap) {
+    uint32_t cap = f->cap ? 2 * f->cap : FTREE_INIT_CAP;
+
+    f->wire = ftree_realloc(f->wire, cap * sizeof(*f->wire));
+    f->time = ftree_realloc(f->time, cap * sizeof(*f->time));
+    f->load = ftree_realloc(f->load, cap * sizeof(*f->load));
+    f->nsub = ftree_realloc(f->nsub, cap * sizeof(*f->nsub));
+    f->id   = ftree_realloc(f->id,   cap * sizeof(*f->id));
+    f->leaf = ftree_realloc(f->leaf, cap / 8);
+    memset(f->leaf + f->cap / 8, 0, (cap - f->cap) / 8);
+    f->cap = cap;
+  }
+  F_ID(f, i) = id;
+  F_WIRE(f, i) = wire;
+  return i;
+}
+
+/* As ftree_add_leaf, for name handle id. */
+static uint32_t
+ftree_put_leaf(FTree f, uint32_t id, double wire, double time, double load)
+{
+  uint32_t i = ftree_add(f, id, wire);
+
+  f->leaf[i >> 3] |= 1 << (i & 7);
+  F_TIME(f, i) = time;
+  F_LOAD(f, i) = load;
+  F_NSUB(f, i) = 0;
+  return i;
+}
+
+/* As ftree_add_inode, for name handle id. */
+static uint32_t
+ftree_put_inode(FTree f, uint32_t id, double wire, uint32_t nsub)
+{
+  uint32_t i = ftree_add(f, id, wire);
+
+  F_TIME(f, i) = F_LOAD(f, i) = 0.0;
+  F_NSUB(f, i) = nsub;
+  return i;
+}
+
+uint32_t
+ftree_add_leaf(FTree f, const char *id, double wire, double time, double load)
+{
+  return ftree_put_leaf(f, names_intern(f->names, id), wire, time, load);
+}
+
+uint32_t
+ftree_add_inode(FTree f, const char *id, double wire, uint32_t nsub)
+{
+  return ftree_put_inode(f, names_intern(f->names, id), wire, nsub);
+}
+
+static void
+flatten_node(Tree k, void *f)
+{
+  if (T_LEAF(k))
+    ftree_put_leaf(f, T_ID(k), T_WIRE(k), T_TIME(k), T_LOAD(k));
+  else
+    ftree_put_inode(f, T_ID(k), T_WIRE(k), T_NSUB(k));
+}
+
+FTree
+tree_flatten(Tree t, Names *nt)
+{
+  FTree f = ftree_mk();
+
+  tree_flatten_into(t, nt, f);
+  return f;
+}
+
+void
+tree_flatten_into(Tree t, Names *nt, FTree f)
+{
+  /* Leaf bits are only ever set: */
+  if (f->n)
+    memset(f->leaf, 0, (f->n + 7) / 8);
+  f->n = 0;
+  /* The handles of t are those of nt: */
+  if (!f->shared)
+    names_free(f->names);
+  f->names = nt;
+  f->shared = 1;
+  tree_postorder(t, flatten_node, f);
+}
+
+Tree
+ftree_tree(FTree f)
+{
+  /* A tree of n nodes has n - 1 subtrees: */
+  uint32_t i, n = F_SIZE(f);
+  struct Node_S *nodes = ftree_realloc(NULL, n * sizeof(*nodes)
+				       + (n - 1) * sizeof(Tree));
+  Tree *subs = (Tree *) (nodes + n);
+  /* The subtrees not yet consumed by their parent: */
+  Tree *stack = ftree_realloc(NULL, n * sizeof(*stack));
+  uint32_t top = 0;
+
+  for (i = 0; i < n; i++) {
+    Tree k = &nodes[i];
+
+    T_ID(k) = F_ID(f, i);
+    T_WIRE(k) = F_WIRE(f, i);
+    T_DATA(k) = NULL;
+    if ((T_LEAF(k) = F_LEAF(f, i))) {
+      T_TIME(k) = F_TIME(f, i);
+      T_LOAD(k) = F_LOAD(f, i);
+    }
+    else {
+      T_NSUB(k) = F_NSUB(f, i);
+      top -= T_NSUB(k);
+      k->u.i.sub = subs;
+      memcpy(subs, stack + top, T_NSUB(k) * sizeof(*subs));
+      subs += T_NSUB(k);
+    }
+    stack[top++] = k;
+  }
+  free(stack);
+  return &nodes[F_ROOT(f)];
+}
+
+void
+ftree_free(FTree f)
+{
+  if (f->cap) {
+    free(f->wire);
+    free(f->time);
+    free(f->load);
+    free(f->nsub);
+    free(f->leaf);
+    free(f->id);
+  }
+  if (!f->shared)
+    names_free(f->names);
+  free(f);
+}
@@ -15,6 +15,8 @@
 #include <string.h>
 #include <ctype.h>
 #include <alloca.h>
+#include <stdint.h>
+#include "names.h"
 
 #if defined __cplusplus
 extern "C" {
@@ -26,28 +28,47 @@ extern "C" {
 
 /* Tree node field access macros: */
 #define T_LEAF(x)		((x)->leaf)
-#define T_NAME(x)		((x)->id)
+#define T_ID(x)			((x)->id)
+/* Name string of node x, whose tree has its names in table nt: */
+#define T_NAME(x,nt)		NAMES_STR(nt, (x)->id)
 #define T_DATA(x)		((x)->data)
 #define T_WIRE(x)		((x)->wire)
 /* Next are only valid for leaf nodes: */
 #define T_TIME(x)		((x)->u.l.time)
 #define T_LOAD(x)		((x)->u.l.load)
 /* Next are only valid for internal nodes: */
-#define T_SUB1(x)		((x)->u.i.sub1)
-#define T_SUB2(x)		((x)->u.i.sub2)
+#define T_NSUB(x)		((x)->u.i.nsub)
+#define T_SUB(x,j)		((x)->u.i.sub[j])
+
+/* Flat tree node field access macros, for node index i of flat tree f;
+   they mirror the ones above:
+*/
+#define F_SIZE(f)		((f)->n)
+#define F_ROOT(f)		((f)->n - 1)
+#define F_LEAF(f,i)		(((f)->leaf[(i) >> 3] >> ((i) & 7)) & 1)
+#define F_ID(f,i)		((f)->id[i])
+#define F_NAME(f,i)		NAMES_STR((f)->names, (f)->id[i])
+#define F_WIRE(f,i)		((f)->wire[i])
+/* Next are only valid for leaf nodes: */
+#define F_TIME(f,i)		((f)->time[i])
+#define F_LOAD(f,i)		((f)->load[i])
+/* Next are only valid for internal nodes: */
+#define F_NSUB(f,i)		((f)->nsub[i])
 
 /* ------------------------------------------------------------------------ */
 /* TYPE DEFINITIONS							    */
 /* ------------------------------------------------------------------------ */
 
 /* Data structure for fanout trees:
-   A binary tree with internal nodes that represent signal branching points,
-   and leaf nodes that represent sinks.
+   A tree with internal nodes that represent signal branching points, each
+   with one or more subtrees, and leaf nodes that represent sinks.
+   Node names are kept in a table of names, see names.h, that goes with
+   the tree.
 */
 typedef struct Node_S *Tree;
 struct Node_S {
   int leaf;			/* 1 for leaf node, 0 otherwise */
-  const char *id;		/* identification string */
+  uint32_t id;			/* handle of identification string */
   double wire;			/* length of wire to (virtual) parent node */
   union {
     struct {
@@ -55,24 +76,97 @@ struct Node_S {
       double load;		/* sink capacitive load */
     } l;
     struct {
-      Tree sub1;		/* internal node first subtree */
-      Tree sub2;		/* internal node second subtree */
+      Tree *sub;		/* internal node subtrees */
+      unsigned nsub;		/* number of them */
     } i;
   } u;
   void *data;			/* node application data */
 };
 
+/* Flat representation of the same fanout trees:
+   nodes are numbered in post-order, i.e., the complete subtrees of a node
+   come one after the other, in order, and the last one directly precedes
+   the node itself; the root is last. The subtrees of an internal node
+   with nsub of them are thus the nsub ones most recently completed.
+   Node fields are kept in separate arrays, so that a bottom-up pass
+   streams through memory in index order. Node names are in a table of
+   the tree itself, unless it shares one.
+*/
+typedef struct FTree_S *FTree;
+struct FTree_S {
+  uint32_t n;			/* number of nodes */
+  uint32_t cap;			/* allocated number of nodes, 0 if not owned */
+  double *wire;			/* length of wire to (virtual) parent node */
+  double *time;			/* sink required arrival time */
+  double *load;			/* sink capacitive load */
+  uint32_t *nsub;		/* internal node number of subtrees */
+  unsigned char *leaf;		/* bit i set for leaf node i */
+  uint32_t *id;			/* handles of identification strings */
+  Names *names;			/* the table they are in */
+  int shared;			/* names is not owned */
+};
+
 /* ------------------------------------------------------------------------ */
 /* FUNCTION PROTOTYPES							    */
 /* ------------------------------------------------------------------------ */
 
-/* Returns a leaf node containing the data supplied. */
-Tree tree_mk_leaf(const char *id, double wire, double time, double load);
+/* Returns a leaf node containing the data supplied; id is the handle of
+   its name.
+*/
+Tree tree_mk_leaf(uint32_t id, double wire, double time, double load);
+
+/* Returns a freshly created internal tree node with as children the
+   `nsub' > 0 trees in `sub' (which is copied), and the additionally
+   supplied data.
+*/
+Tree tree_mk_inode(uint32_t id, double wire, unsigned nsub,
+		   const Tree *sub);
+
+/* Calls visit(k, arg) for every node k of tree t in post-order, i.e.,
+   children before their parent. Uses an explicit stack, so the depth of
+   the tree is not limited by the call stack.
+*/
+void tree_postorder(Tree t, void (*visit)(Tree k, void *arg), void *arg);
+
+/* Returns a new, empty flat tree, with a table of names of its own. */
+FTree ftree_mk(void);
+
+/* As ftree_mk, but the flat tree takes table nt for its names. */
+FTree ftree_mk_names(Names *nt);
+
+/* Appends a leaf node containing the data supplied to flat tree f, adding
+   its name id to the table of f. Returns its index.
+*/
+uint32_t ftree_add_leaf(FTree f, const char *id, double wire,
+			double time, double load);
+
+/* Appends an internal node to flat tree f with as children the `nsub' > 0
+   subtrees most recently completed. Returns its index.
+*/
+uint32_t ftree_add_inode(FTree f, const char *id, double wire,
+			 uint32_t nsub);
+
+/* Returns the flat representation of tree t, whose names are in table
+   nt; the flat tree shares nt, which must outlive it.
+*/
+FTree tree_flatten(Tree t, Names *nt);
+
+/* As tree_flatten, but into flat tree f made by ftree_mk, which is
+   emptied first and keeps its memory for reuse.
+*/
+void tree_flatten_into(Tree t, Names *nt, FTree f);
+
+/* Returns the tree represented by flat tree f; all its nodes are
+   allocated as a single block, node i of f at index i, so that the
+   returned root is last, followed by the arrays of subtrees. Node names
+   are in the table of f.
+*/
+Tree ftree_tree(FTree f);
 
-/* Returns a freshly created internal tree node with as children
-   `sub1' and `sub2' and the additionally supplied data.
+/* Frees flat tree f, including its node arrays and table of names when
+   it owns them.
 */
-Tree tree_mk_inode(const char *id, double wire, Tree sub1, Tree sub2);
+void ftree_free(FTree f);
 
 #ifdef __cplusplus
 }
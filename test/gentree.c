@@ -0,0 +1,210 @@
+/* Copyright (c) 2003 ACM/SIGDA
+   Prepared by Geert Janssen, geert@us.ibm.com
+*/
+
+/* Generates a synthetic fanout tree in the input format described in
+   src/parser.h and writes it to stdout.
+
+   Usage: gentree [-t shape] [-n nodes] [-s seed] [-T spread] [-L spread]
+
+   Shapes:
+     caterpillar  a chain of internal nodes each of which has a sink as
+                  first subtree, ending in two sinks. Such a tree is as
+                  deep as can be for its size, which makes it a good test
+                  for stack usage. This is the default.
+     balanced     both subtrees of every internal node have (about) the
+                  same number of sinks.
+     real         subtree sizes split at random, so that depth is
+                  logarithmic on average but varies; wires are mostly
+                  short with an occasional long one, and most sinks have
+                  a small load, as in placed nets.
+
+   Sink required times lie in [1000,1000+T] and loads in [1,1+L]; the
+   larger these spreads, the more options survive pruning. The defaults
+   are T = 100 and L = 9.
+   The output depends only on the arguments, not on the platform's random
+   number generator.
+*/
+
+/* ------------------------------------------------------------------------ */
+/* INCLUDES                                                                 */
+/* ------------------------------------------------------------------------ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* ------------------------------------------------------------------------ */
+/* LOCAL VARIABLES                                                          */
+/* ------------------------------------------------------------------------ */
+
+static unsigned long long seed = 1;
+
+/* Spreads of sink required time and load: */
+static double time_spread = 100.0;
+static double load_spread = 9.0;
+
+/* Number of internal nodes and sinks written so far: */
+static unsigned long inodes, sinks;
+
+/* Draw wires and loads as in placed nets: */
+static int realistic;
+
+/* ------------------------------------------------------------------------ */
+/* FUNCTION DEFINITIONS                                                     */
+/* ------------------------------------------------------------------------ */
+
+/* Returns a pseudo-random number uniformly distributed in [lo,hi]
+   rounded to one decimal.
+*/
+static double
+uniform(double lo, double hi)
+{
+  /* Knuth's MMIX linear congruential generator: */
+  seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+  return lo + (hi - lo) * (double) ((seed >> 33) % 1001) / 1000.0;
+}
+
+/* Returns a pseudo-random number uniformly distributed in [0,n). */
+static unsigned long
+choose(unsigned long n)
+{
+  seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+  return (seed >> 11) % n;
+}
+
+/* Returns a wire length; for realistic nets mostly short, one in ten
+   long.
+*/
+static double
+wire(void)
+{
+  if (!realistic)
+    return uniform(0.0, 10.0);
+  return choose(10) ? uniform(0.0, 2.0) : uniform(10.0, 100.0);
+}
+
+/* Returns a sink load; for realistic nets skewed towards the low end. */
+static double
+load(void)
+{
+  double u;
+
+  if (!realistic)
+    return uniform(1.0, 1.0 + load_spread);
+  u = uniform(0.0, 1.0);
+  return 1.0 + load_spread * u * u;
+}
+
+static void
+sink(void)
+{
+  /* Draw in a fixed order, so that the output does not depend on the
+     compiler's argument evaluation order:
+  */
+  double L = load();
+  double T = uniform(1000.0, 1000.0 + time_spread);
+  double w = wire();
+
+  printf("< sink%lu %.1f %.1f %.1f >\n", sinks++, w, T, L);
+}
+
+static void
+caterpillar(unsigned long nodes)
+{
+  unsigned long i, n = nodes / 2;
+
+  printf("# Caterpillar tree of %lu nodes\n", 2 * n + 1);
+  for (i = 0; i < n; i++) {
+    printf("( node%lu %.1f\n", inodes++, wire());
+    sink();
+  }
+  sink();
+  for (i = 0; i < n; i++)
+    printf(")\n");
+}
+
+/* Writes a balanced subtree with n sinks. */
+static void
+balanced(unsigned long n)
+{
+  if (n == 1) {
+    sink();
+    return;
+  }
+  printf("( node%lu %.1f\n", inodes++, wire());
+  balanced(n / 2);
+  balanced(n - n / 2);
+  printf(")\n");
+}
+
+/* Writes a subtree with n sinks, split at random. */
+static void
+real(unsigned long n)
+{
+  unsigned long n1;
+
+  if (n == 1) {
+    sink();
+    return;
+  }
+  n1 = 1 + choose(n - 1);
+  printf("( node%lu %.1f\n", inodes++, wire());
+  real(n1);
+  real(n - n1);
+  printf(")\n");
+}
+
+static void
+usage(const char *prog)
+{
+  fprintf(stderr, "Usage: %s [-t caterpillar|balanced|real] [-n nodes]"
+	  " [-s seed] [-T spread] [-L spread]\n", prog);
+  exit(EXIT_FAILURE);
+}
+
+int
+main(int argc, char *argv[])
+{
+  unsigned long nodes = 1000;
+  const char *shape = "caterpillar";
+  int c;
+
+  while ((c = getopt(argc, argv, "t:n:s:T:L:")) != -1)
+    switch (c) {
+    case 't':
+      shape = optarg;
+      break;
+    case 'n':
+      nodes = strtoul(optarg, NULL, 10);
+      break;
+    case 's':
+      seed = strtoull(optarg, NULL, 10);
+      break;
+    case 'T':
+      time_spread = strtod(optarg, NULL);
+      break;
+    case 'L':
+      load_spread = strtod(optarg, NULL);
+      break;
+    default:
+      usage(argv[0]);
+    }
+
+  /* A binary tree with n sinks has 2n-1 nodes: */
+  if (!strcmp(shape, "caterpillar"))
+    caterpillar(nodes);
+  else if (!strcmp(shape, "balanced")) {
+    printf("# Balanced tree of %lu nodes\n", 2 * (nodes / 2) + 1);
+    balanced(nodes / 2 + 1);
+  }
+  else if (!strcmp(shape, "real")) {
+    printf("# Random tree of %lu nodes\n", 2 * (nodes / 2) + 1);
+    realistic = 1;
+    real(nodes / 2 + 1);
+  }
+  else
+    usage(argv[0]);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,215 @@
+/* Copyright (c) 2003 ACM/SIGDA
+   Prepared by Geert Janssen, geert@us.ibm.com
+*/
+
+/* Checks and times the options list kernels of src/kernels.c.
+
+   Usage: kbench [-c]
+
+   With -c, checks that every implementation the processor supports gives
+   results bit-identical to the scalar one on random lists of 1 to 300
+   options, and exits with a failure status when one does not.
+   Without, times each kernel of each implementation on lists of 16 to
+   4096 options, printing one line of name=value fields per measurement;
+   speedup is relative to the scalar implementation.
+*/
+
+/* ------------------------------------------------------------------------ */
+/* INCLUDES                                                                 */
+/* ------------------------------------------------------------------------ */
+
+#include <time.h>
+#include <unistd.h>
+#include "kernels.h"
+
+/* ------------------------------------------------------------------------ */
+/* LOCAL DEFINES                                                            */
+/* ------------------------------------------------------------------------ */
+
+#define MAX_LEN		4096
+/* Options processed per measurement: */
+#define WORK		(1 << 24)
+
+/* ------------------------------------------------------------------------ */
+/* LOCAL VARIABLES                                                          */
+/* ------------------------------------------------------------------------ */
+
+static const char *const names[] = { "scalar", "avx2", "avx512" };
+#define NAMES		(sizeof(names) / sizeof(names[0]))
+
+static unsigned long long seed = 1;
+
+/* Keeps the compiler from optimizing timed calls away: */
+static volatile double sink;
+
+/* ------------------------------------------------------------------------ */
+/* FUNCTION DEFINITIONS                                                     */
+/* ------------------------------------------------------------------------ */
+
+/* Returns a pseudo-random number uniformly distributed in [0,1). */
+static double
+uniform(void)
+{
+  seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+  return (seed >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/* Fills p with n options sorted on load, as a wire or buffer update
+   leaves them: times mostly increase, but some options are inferior and
+   a few improve by less than EPS.
+*/
+static void
+fill(Pair *p, size_t n)
+{
+  double T = 1000.0, L = 1.0;
+  size_t i;
+
+  for (i = 0; i < n; i++) {
+    double u = uniform();
+
+    L += uniform();
+    if (u < 0.6)
+      T += 10.0 * uniform();
+    else if (u < 0.61)
+      T += EPS * uniform();
+    else
+      T -= 5.0 * uniform();
+    PTIME(p[i]) = T;
+    PLOAD(p[i]) = L;
+  }
+}
+
+static double
+now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Compares implementation k with the scalar one s; returns the number of
+   differences.
+*/
+static int
+check(const Kernels *s, const Kernels *k)
+{
+  static Pair p[300], q[300], r[300];
+  int errors = 0;
+  size_t n;
+
+  for (n = 1; n <= 300; n++) {
+    size_t m1, m2;
+
+    fill(p, n);
+    memcpy(q, p, n * sizeof(*p));
+    s->add_wire(p, n, 0.37 * 1.9 / 2.0, 0.37, 1.9);
+    k->add_wire(q, n, 0.37 * 1.9 / 2.0, 0.37, 1.9);
+    if (memcmp(p, q, n * sizeof(*p))) {
+      fprintf(stderr, "%s add_wire differs for %lu options\n", k->name,
+	      (unsigned long) n);
+      errors++;
+    }
+    if (s->buffered_max(p, n, 10.0, 2.0)
+	!= k->buffered_max(p, n, 10.0, 2.0)) {
+      fprintf(stderr, "%s buffered_max differs for %lu options\n", k->name,
+	      (unsigned long) n);
+      errors++;
+    }
+    /* Also as seen through a wire not applied yet: */
+    memcpy(r, p, n * sizeof(*p));
+    m1 = s->filter(r, n, 0.37);
+    m2 = k->filter(q, n, 0.37);
+    if (m1 != m2 || memcmp(r, q, m1 * sizeof(*p))) {
+      fprintf(stderr, "%s filter through a wire differs for %lu options\n",
+	      k->name, (unsigned long) n);
+      errors++;
+    }
+    memcpy(q, p, n * sizeof(*p));
+    m1 = s->filter(p, n, 0.0);
+    m2 = k->filter(q, n, 0.0);
+    if (m1 != m2 || memcmp(p, q, m1 * sizeof(*p))) {
+      fprintf(stderr, "%s filter differs for %lu options\n", k->name,
+	      (unsigned long) n);
+      errors++;
+    }
+  }
+  return errors;
+}
+
+/* Returns the time in nanoseconds per option of kernel number kernel of
+   implementation k on lists of n options.
+*/
+static double
+measure(const Kernels *k, int kernel, size_t n)
+{
+  /* Aligned like the vector stores of add_wire, which in the solver
+     mostly precede the filter:
+  */
+  static Pair orig[MAX_LEN] __attribute__ ((aligned (64)));
+  static Pair p[MAX_LEN] __attribute__ ((aligned (64)));
+  size_t reps = WORK / n, r;
+  double start, t = 0.0;
+
+  fill(orig, n);
+  memcpy(p, orig, n * sizeof(*p));
+  start = now();
+  for (r = 0; r < reps; r++)
+    switch (kernel) {
+    case 0:
+      /* Alternate signs so that the values stay put: */
+      k->add_wire(p, n, r & 1 ? -0.01 : 0.01, r & 1 ? -0.1 : 0.1,
+		  r & 1 ? -0.2 : 0.2);
+      break;
+    case 1:
+      t += k->buffered_max(p, n, 10.0, 2.0);
+      break;
+    default:
+      /* Includes restoring the list, also done for the scalar version: */
+      memcpy(p, orig, n * sizeof(*p));
+      t += k->filter(p, n, 0.0);
+    }
+  sink = t;
+  return (now() - start) * 1e9 / ((double) reps * n);
+}
+
+int
+main(int argc, char *argv[])
+{
+  static const char *const kernel_names[] = {
+    "add_wire", "buffered_max", "filter"
+  };
+  const Kernels *s = kernels_find("scalar");
+  size_t i, n;
+  int c, errors = 0, kernel;
+
+  while ((c = getopt(argc, argv, "c")) != -1)
+    if (c != 'c') {
+      fprintf(stderr, "Usage: %s [-c]\n", argv[0]);
+      return EXIT_FAILURE;
+    }
+    else {
+      for (i = 1; i < NAMES; i++)
+	if (kernels_find(names[i]))
+	  errors += check(s, kernels_find(names[i]));
+      return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+
+  for (kernel = 0; kernel < 3; kernel++)
+    for (n = 16; n <= MAX_LEN; n *= 4) {
+      double scalar = measure(s, kernel, n);
+
+      for (i = 0; i < NAMES; i++) {
+	const Kernels *k = kernels_find(names[i]);
+	double ns;
+
+	if (!k)
+	  continue;
+	ns = i ? measure(k, kernel, n) : scalar;
+	printf("kernel=%s impl=%s len=%lu ns_per_option=%.3f speedup=%.2f\n",
+	       kernel_names[kernel], k->name, (unsigned long) n, ns,
+	       scalar / ns);
+      }
+    }
+  return EXIT_SUCCESS;
+}
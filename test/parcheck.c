@@ -0,0 +1,121 @@
+/* Copyright (c) 2003 ACM/SIGDA
+   Prepared by Geert Janssen, geert@us.ibm.com
+*/
+
+/* Checks that solving in parallel gives the same results as solving
+   serially, to the last bit.
+
+   Usage: parcheck [-n trees] [-j threads]
+
+   Solves random trees of up to 300 sinks, with internal nodes of one to
+   four subtrees, 1000 of them by default, both with engine_solve and with
+   engine_solve_par, and exits with a failure status when any result
+   differs. The parallel path only splits off subtrees of at least
+   PAR_CUTOFF nodes, so this is meant to be linked with an engine compiled
+   with a small one, see the Makefile.
+*/
+
+/* ------------------------------------------------------------------------ */
+/* INCLUDES                                                                 */
+/* ------------------------------------------------------------------------ */
+
+#include <unistd.h>
+#include "engine.h"
+
+/* ------------------------------------------------------------------------ */
+/* LOCAL VARIABLES                                                          */
+/* ------------------------------------------------------------------------ */
+
+static unsigned long long seed = 1;
+
+/* ------------------------------------------------------------------------ */
+/* FUNCTION DEFINITIONS                                                     */
+/* ------------------------------------------------------------------------ */
+
+/* Returns a pseudo-random number uniformly distributed in [0,1). */
+static double
+uniform(void)
+{
+  seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+  return (seed >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/* Returns a pseudo-random number in 0..n-1. */
+static unsigned
+pick(unsigned n)
+{
+  return uniform() * n;
+}
+
+/* Returns a random flat tree of the given number of sinks. Completed
+   subtrees are joined under new internal nodes at random moments, with
+   as many single-subtree nodes as others, so that wires are often left
+   pending across the subtree boundaries the parallel solver cuts at.
+*/
+static FTree
+random_tree(unsigned sinks)
+{
+  FTree f = ftree_mk();
+  unsigned i, top = 0, nsub;
+  char id[32];
+
+  for (i = 0; i < sinks; i++) {
+    sprintf(id, "s%u", i);
+    ftree_add_leaf(f, id, 10.0 * uniform(), 500.0 + 1000.0 * uniform(),
+		   1.0 + 20.0 * uniform());
+    top++;
+    while (pick(3) == 0 || (i + 1 == sinks && top > 1)) {
+      nsub = pick(2) ? 1 : 2 + pick(3);
+      if (nsub > top)
+	nsub = top;
+      sprintf(id, "n%u", F_SIZE(f));
+      ftree_add_inode(f, id, 10.0 * uniform(), nsub);
+      top -= nsub - 1;
+    }
+  }
+  return f;
+}
+
+int
+main(int argc, char *argv[])
+{
+  unsigned long trees = 1000, i, failed = 0;
+  int c, threads = 4;
+  Pool *pool;
+  Engine e;
+
+  while ((c = getopt(argc, argv, "n:j:")) != -1)
+    switch (c) {
+    case 'n':
+      trees = atol(optarg);
+      break;
+    case 'j':
+      if ((threads = atoi(optarg)) >= 1)
+	break;
+      /* FALLTHROUGH */
+    default:
+      fprintf(stderr, "Usage: %s [-n trees] [-j threads]\n", argv[0]);
+      return EXIT_FAILURE;
+    }
+
+  pool = pool_mk(threads);
+  engine_init(&e, &tech_default);
+  for (i = 0; i < trees; i++) {
+    FTree f = random_tree(1 + pick(300));
+    Result r1 = engine_solve(&e, f);
+    Result r2 = engine_solve_par(&e, f, pool);
+
+    if (memcmp(&r1.nb, &r2.nb, sizeof(r1.nb))
+	|| memcmp(&r1.best, &r2.best, sizeof(r1.best))) {
+      fprintf(stderr, "tree %lu: serial best (%a, %a), parallel (%a, %a)\n",
+	      i, r1.best.T, r1.best.L, r2.best.T, r2.best.L);
+      failed++;
+    }
+    ftree_free(f);
+  }
+  engine_done(&e);
+  pool_free(pool);
+  if (failed)
+    fprintf(stderr, "%lu of %lu trees differ.\n", failed, trees);
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}